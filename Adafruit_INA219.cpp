@@ -24,56 +24,346 @@
  #include "WProgram.h"
 #endif
 
-#include <Wire.h>
-
 #include "Adafruit_INA219.h"
 
+// SCL clock last set on Wire, shared by all the instances on the bus
+static uint32_t wireClock = INA219_I2C_CLOCK_STANDARD;
+
+/**************************************************************************/
+/*! 
+    @brief  Opens a public call: the outermost one sets the start of
+            the retry deadline
+*/
+/**************************************************************************/
+Adafruit_INA219::Call::Call(Adafruit_INA219 *ina219)
+{
+  call_ina219 = ina219;
+  if (ina219->ina219_callDepth++ == 0)
+    ina219->ina219_callStart_us = micros();
+}
+
+Adafruit_INA219::Call::~Call()
+{
+  call_ina219->ina219_callDepth--;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns when the deadline of a register access starts: at
+            the start of the public call making it, if any
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219::wireCallStart()
+{
+  return ina219_callDepth ? ina219_callStart_us : micros();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Fails a register access without touching the bus once the
+            call's deadline has passed
+*/
+/**************************************************************************/
+bool Adafruit_INA219::wireExpired(uint32_t start)
+{
+  if (!ina219_deadline_us || (micros() - start) < ina219_deadline_us)
+    return false;
+  ina219_lastError = INA219_ERR_TIMEOUT;
+  ina219_errorCount++;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the bus ready for a transaction with this device: sets
+            its SCL clock if another device changed it and, in
+            high-speed mode, sends the HS master code at fast mode
+            first since the INA219 drops back to F/S mode on each STOP
+*/
+/**************************************************************************/
+void Adafruit_INA219::wireBeginBus()
+{
+#ifdef INA219_I2C_HS_CAPABLE
+  if (ina219_i2cClock > INA219_I2C_CLOCK_FAST) {
+    Wire.setClock(INA219_I2C_CLOCK_FAST);
+    Wire.beginTransmission(INA219_I2C_HS_MASTER_CODE);
+    Wire.endTransmission(false);           // NACK expected, keep the bus
+    Wire.setClock(ina219_i2cClock);
+    wireClock = ina219_i2cClock;
+    return;
+  }
+#endif
+#ifdef INA219_WIRE_SETCLOCK
+  if (wireClock != ina219_i2cClock) {
+    Wire.setClock(ina219_i2cClock);
+    wireClock = ina219_i2cClock;
+  }
+#endif
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Limits the Wire timeout to what is left of the current call's
+            deadline, where the Wire implementation has one
+*/
+/**************************************************************************/
+void Adafruit_INA219::wireArmTimeout(uint32_t start)
+{
+#ifdef WIRE_HAS_TIMEOUT
+  if (ina219_deadline_us) {
+    uint32_t used = micros() - start;
+    Wire.setWireTimeout(used < ina219_deadline_us ? ina219_deadline_us - used : 1, true);
+  }
+#endif
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Maps the return value of Wire.endTransmission() to an
+            INA219_ERR_* status
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219::wireStatus(uint8_t result)
+{
+#ifdef WIRE_HAS_TIMEOUT
+  if (Wire.getWireTimeoutFlag()) {
+    Wire.clearWireTimeoutFlag();
+    return INA219_ERR_TIMEOUT;
+  }
+#endif
+  switch (result) {
+    case 0:  return INA219_OK;
+    case 2:                                // address NACK
+    case 3:  return INA219_ERR_NACK;       // data NACK
+    case 5:  return INA219_ERR_TIMEOUT;
+    default: return INA219_ERR_BUS;
+  }
+}
+
 /**************************************************************************/
 /*! 
     @brief  Sends a single command byte over I2C
 */
 /**************************************************************************/
-void Adafruit_INA219::wireWriteRegister (uint8_t reg, uint16_t value)
+uint8_t Adafruit_INA219::wireWriteOnce(uint8_t reg, const uint8_t *data, uint8_t len, uint32_t start)
 {
+  wireBeginBus();
+  wireArmTimeout(start);
   Wire.beginTransmission(ina219_i2caddr);
   #if ARDUINO >= 100
     Wire.write(reg);                       // Register
-    Wire.write((value >> 8) & 0xFF);       // Upper 8-bits
-    Wire.write(value & 0xFF);              // Lower 8-bits
+    while (len--)
+      Wire.write(*data++);                 // Upper then lower 8-bits
   #else
     Wire.send(reg);                        // Register
-    Wire.send(value >> 8);                 // Upper 8-bits
-    Wire.send(value & 0xFF);               // Lower 8-bits
+    while (len--)
+      Wire.send(*data++);                  // Upper then lower 8-bits
   #endif
-  Wire.endTransmission();
+  return wireStatus(Wire.endTransmission());
 }
 
 /**************************************************************************/
 /*! 
-    @brief  Reads a 16 bit values over I2C
+    @brief  Reads the 2 bytes of the register the pointer is set to
 */
 /**************************************************************************/
-void Adafruit_INA219::wireReadRegister(uint8_t reg, uint16_t *value)
+uint8_t Adafruit_INA219::wireReadOnce(uint16_t *value, uint32_t start)
 {
-
-  Wire.beginTransmission(ina219_i2caddr);
+  wireBeginBus();
+  wireArmTimeout(start);
+  // TinyWireM's requestFrom() returns 0 on success where Wire returns
+  // the byte count, what was received is the same on both
+  Wire.requestFrom(ina219_i2caddr, (uint8_t)2);
+  if (Wire.available() < 2) {
+    // drop a partial read so it doesn't end up in the next one
+    while (Wire.available())
   #if ARDUINO >= 100
-    Wire.write(reg);                       // Register
+      Wire.read();
   #else
-    Wire.send(reg);                        // Register
+      Wire.receive();
   #endif
-  Wire.endTransmission();
-  
-  delay(1); // Max 12-bit conversion time is 586us per sample
-
-  Wire.requestFrom(ina219_i2caddr, (uint8_t)2);  
+    uint8_t status = wireStatus(0);
+    return (status == INA219_OK) ? INA219_ERR_SHORT_READ : status;
+  }
   #if ARDUINO >= 100
     // Shift values to create properly formed integer
-    *value = ((Wire.read() << 8) | Wire.read());
+    *value = Wire.read() << 8;
+    *value |= Wire.read();
   #else
     // Shift values to create properly formed integer
-    *value = ((Wire.receive() << 8) | Wire.receive());
+    *value = Wire.receive() << 8;
+    *value |= Wire.receive();
   #endif
+  return INA219_OK;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Handles a failed transfer: records it, and when the retry
+            policy and the call's deadline allow it, runs the bus
+            recovery hook and returns true to try again
+*/
+/**************************************************************************/
+bool Adafruit_INA219::wireRetry(uint8_t status, uint8_t attempt, uint32_t start)
+{
+  ina219_lastError = status;
+  ina219_errorCount++;
+  // a failed transfer may have left the pointer anywhere
+  ina219_pointer = INA219_REG_NONE;
+
+  if (attempt >= ina219_retries)
+    return false;
+  if (ina219_deadline_us && (micros() - start) >= ina219_deadline_us) {
+    ina219_lastError = INA219_ERR_TIMEOUT;
+    return false;
+  }
+  if (ina219_busRecovery != NULL)
+    ina219_busRecovery();
+  ina219_retryCount++;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Writes a 16 bit register over I2C, returns an INA219_ERR_*
+            status
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219::wireWriteRegister (uint8_t reg, uint16_t value)
+{
+  uint8_t data[2] = { (uint8_t)(value >> 8), (uint8_t)(value & 0xFF) };
+  uint32_t start = wireCallStart();
+
+  if (wireExpired(start))
+    return INA219_ERR_TIMEOUT;
+  for (uint8_t attempt = 0; ; attempt++) {
+    uint8_t status = wireWriteOnce(reg, data, 2, start);
+    if (status == INA219_OK) {
+      ina219_pointer = reg;
+      return INA219_OK;
+    }
+    if (!wireRetry(status, attempt, start))
+      return ina219_lastError;
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads a 16 bit values over I2C, returns an INA219_ERR_*
+            status and 0 in 'value' on failure
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219::wireReadRegister(uint8_t reg, uint16_t *value)
+{
+  uint32_t start = wireCallStart();
+
+  if (wireExpired(start)) {
+    *value = 0;
+    return INA219_ERR_TIMEOUT;
+  }
+  for (uint8_t attempt = 0; ; attempt++) {
+    uint8_t status = wireWriteOnce(reg, NULL, 0, start);
+
+    // No wait is needed here, reading a register doesn't start a
+    // conversion and always returns the last completed one
+
+    if (status == INA219_OK)
+      status = wireReadOnce(value, start);
+    if (status == INA219_OK) {
+      ina219_pointer = reg;
+      return INA219_OK;
+    }
+    if (!wireRetry(status, attempt, start)) {
+      *value = 0;
+      return ina219_lastError;
+    }
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads a 16 bit value over I2C from the register the pointer
+            was last set to, the INA219 keeps it between reads
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219::wireReadPointed(uint16_t *value)
+{
+  uint32_t start = wireCallStart();
+
+  if (wireExpired(start)) {
+    *value = 0;
+    return INA219_ERR_TIMEOUT;
+  }
+  for (uint8_t attempt = 0; ; attempt++) {
+    uint8_t status = wireReadOnce(value, start);
+    if (status == INA219_OK)
+      return INA219_OK;
+    if (!wireRetry(status, attempt, start)) {
+      *value = 0;
+      return ina219_lastError;
+    }
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Writes the config register and keeps a shadow copy of it so
+            that later changes don't have to read it back first.  While
+            held (see holdConfig()) only the shadow copy changes.
+*/
+/**************************************************************************/
+void Adafruit_INA219::writeConfig(uint16_t config)
+{
+  ina219_config = config;
+  if (ina219_configHeld) {
+    ina219_configPending = true;
+    return;
+  }
+  wireWriteRegister(INA219_REG_CONFIG, config);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the time in us one ADC conversion takes for the given
+            4-bit SADC/BADC setting (see the CONFIG register defines)
+*/
+/**************************************************************************/
+static uint32_t adcConversionTime_us(uint8_t adc)
+{
+  if (adc & 0x08)
+    return 532UL << (adc & 0x07);          // 12-bit, 1 to 128 samples averaged
+  return 20 + (64UL << (adc & 0x03));      // 84, 148, 276 or 532us
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the time in us a full conversion cycle takes with the
+            shadowed config, that is the shunt and/or bus conversion
+            depending on the operating mode
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219::getConversionTime_us()
+{
+  uint32_t time_us = 0;
+  uint8_t mode = ina219_config & INA219_CONFIG_MODE_MASK;
+
+  if (mode & INA219_CONFIG_MODE_SVOLT_TRIGGERED)
+    time_us += adcConversionTime_us((ina219_config & INA219_CONFIG_SADCRES_MASK) >> 3);
+  if (mode & INA219_CONFIG_MODE_BVOLT_TRIGGERED)
+    time_us += adcConversionTime_us((ina219_config & INA219_CONFIG_BADCRES_MASK) >> 7);
+  return time_us;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Blocks for the given number of us (delayMicroseconds() only
+            handles a few ms on AVR)
+*/
+/**************************************************************************/
+static void delayLong_us(uint32_t time_us)
+{
+  delay(time_us / 1000);
+  delayMicroseconds(time_us % 1000);
 }
 
 /**************************************************************************/
@@ -88,6 +378,7 @@ void Adafruit_INA219::wireReadRegister(uint8_t reg, uint16_t *value)
 /**************************************************************************/
 void Adafruit_INA219::setCalibration_32V_2A(void)
 {
+  Call call(this);
   // By default we use a pretty huge range for the input voltage,
   // which probably isn't the most appropriate choice for system
   // that don't use a lot of power.  But all of the calculations
@@ -162,7 +453,7 @@ void Adafruit_INA219::setCalibration_32V_2A(void)
                     INA219_CONFIG_BADCRES_12BIT |
                     INA219_CONFIG_SADCRES_12BIT_1S_532US |
                     INA219_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
-  wireWriteRegister(INA219_REG_CONFIG, config);
+  writeConfig(config);
 }
 
 /**************************************************************************/
@@ -177,6 +468,7 @@ void Adafruit_INA219::setCalibration_32V_2A(void)
 /**************************************************************************/
 void Adafruit_INA219::setCalibration_32V_1A(void)
 {
+  Call call(this);
   // By default we use a pretty huge range for the input voltage,
   // which probably isn't the most appropriate choice for system
   // that don't use a lot of power.  But all of the calculations
@@ -253,10 +545,11 @@ void Adafruit_INA219::setCalibration_32V_1A(void)
                     INA219_CONFIG_BADCRES_12BIT |
                     INA219_CONFIG_SADCRES_12BIT_1S_532US |
                     INA219_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
-  wireWriteRegister(INA219_REG_CONFIG, config);
+  writeConfig(config);
 }
 
 void Adafruit_INA219::setCalibration_16V_400mA(void) {
+  Call call(this);
   
   // Calibration which uses the highest precision for 
   // current measurement (0.1mA), at the expense of 
@@ -335,7 +628,7 @@ void Adafruit_INA219::setCalibration_16V_400mA(void) {
                     INA219_CONFIG_BADCRES_12BIT |
                     INA219_CONFIG_SADCRES_12BIT_1S_532US |
                     INA219_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
-  wireWriteRegister(INA219_REG_CONFIG, config);
+  writeConfig(config);
 }
 
 /**************************************************************************/
@@ -354,6 +647,7 @@ void Adafruit_INA219::setCalibration_16V_400mA(void) {
 /**************************************************************************/
 void Adafruit_INA219::setCalibration_Def(float r_shunt, float v_shunt_max, float v_bus_max, float i_max_expected)
 {
+  Call call(this);
   uint16_t cal, digits, bvoltage, gain;
   float i_max_possible, min_lsb, max_lsb, swap;
   float current_lsb, power_lsb;
@@ -492,7 +786,7 @@ void Adafruit_INA219::setCalibration_Def(float r_shunt, float v_shunt_max, float
                     INA219_CONFIG_BADCRES_12BIT |
                     INA219_CONFIG_SADCRES_12BIT_1S_532US |
                     INA219_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
-  wireWriteRegister(INA219_REG_CONFIG, config);
+  writeConfig(config);
 }
 
 /**************************************************************************/
@@ -502,6 +796,40 @@ void Adafruit_INA219::setCalibration_Def(float r_shunt, float v_shunt_max, float
 /**************************************************************************/
 Adafruit_INA219::Adafruit_INA219(uint8_t addr) {
   ina219_i2caddr = addr;
+  ina219_i2cClock = INA219_I2C_CLOCK_STANDARD;
+  ina219_retries = 0;
+  ina219_deadline_us = 0;
+  ina219_callDepth = 0;
+  ina219_callStart_us = 0;
+  ina219_busRecovery = NULL;
+  ina219_lastError = INA219_OK;
+  ina219_errorCount = 0;
+  ina219_retryCount = 0;
+  ina219_flags = 0;
+  ina219_pointer = INA219_REG_NONE;
+  ina219_config = 0;
+  ina219_autoRange = false;
+  ina219_rangeSwitches = 0;
+  ina219_rangeLatency_us = 0;
+  ina219_adaptRate_Hz = 0;
+  ina219_adaptLevel = 0;
+  ina219_adaptCount = 0;
+  ina219_dutyPeriod_ms = 0;
+  ina219_dutyAwake = false;
+  ina219_softwarePower = false;
+  ina219_sampleValid = false;
+  ina219_configHeld = false;
+  ina219_configPending = false;
+  ina219_pollTime_us = 0;
+  ina219_pollIdle = false;
+  ina219_edge_us = 0;
+  ina219_edgeError_us = INA219_EDGE_UNKNOWN;
+  ina219_edgeValid = false;
+  resetJitter();
+  ina219_alarmEnabled = 0;
+  ina219_alarmActive = 0;
+  ina219_alarmEvents = 0;
+  ina219_alarmCallback = NULL;
   ina219_currentLsb_mA = 0;
   ina219_powerLsb_mW = 0;
 }
@@ -518,21 +846,307 @@ void Adafruit_INA219::begin(uint8_t addr) {
 
 void Adafruit_INA219::begin(void) {
   Wire.begin();    
+  // Wire.begin() puts the bus back to its default clock
+  wireClock = INA219_I2C_CLOCK_STANDARD;
   // Set chip to large range config values to start
   setCalibration_32V_2A();
 }
 
+/**************************************************************************/
+/*! 
+    @brief  Sets the SCL clock used for this device, it is applied
+            before each transaction so devices on the same bus can run
+            at different speeds.  Above 400kHz the HS master code is
+            sent before each transaction, which needs
+            INA219_I2C_HS_CAPABLE; otherwise the clock is limited to
+            fast mode.  Returns the clock actually used.
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219::setI2CClock(uint32_t clock_Hz) {
+#ifdef INA219_I2C_HS_CAPABLE
+  if (clock_Hz > INA219_I2C_CLOCK_HIGHSPEED)
+    clock_Hz = INA219_I2C_CLOCK_HIGHSPEED;
+#else
+  if (clock_Hz > INA219_I2C_CLOCK_FAST)
+    clock_Hz = INA219_I2C_CLOCK_FAST;
+#endif
+#ifndef INA219_WIRE_SETCLOCK
+  // no Wire.setClock(), the bus stays at the core's default
+  clock_Hz = INA219_I2C_CLOCK_STANDARD;
+#endif
+  ina219_i2cClock = clock_Hz;
+  return clock_Hz;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the SCL clock used for this device
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219::getI2CClock() {
+  return ina219_i2cClock;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sets how I2C failures (NACK, short read, bus timeout) are
+            handled: each register access is tried up to 1 + 'retries'
+            times, calling the bus recovery hook between tries.  Once
+            'deadline_us' (0 = none) has passed since the start of the
+            driver call, retries stop and its remaining accesses fail
+            with INA219_ERR_TIMEOUT without touching the bus.  Where
+            Wire has timeouts (WIRE_HAS_TIMEOUT) each transfer is also
+            limited to what is left of the deadline, so no driver call
+            blocks on the bus for much longer than 'deadline_us',
+            whatever number of accesses it makes.  readN() applies the
+            deadline to each of its reads.
+*/
+/**************************************************************************/
+void Adafruit_INA219::setRetryPolicy(uint8_t retries, uint32_t deadline_us) {
+  ina219_retries = retries;
+  ina219_deadline_us = deadline_us;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sets a function called after a failed transfer before it is
+            retried, e.g. to clock SCL until a stuck slave releases SDA
+*/
+/**************************************************************************/
+void Adafruit_INA219::setBusRecovery(void (*recover)(void)) {
+  ina219_busRecovery = recover;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the INA219_ERR_* status of the last failed register
+            access since the previous call (INA219_OK if none) and
+            clears it.  Readings from a failed access are 0.
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219::getLastError() {
+  uint8_t error = ina219_lastError;
+  ina219_lastError = INA219_OK;
+  return error;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the number of failed transfers, retried or not
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219::getErrorCount() {
+  return ina219_errorCount;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the number of retries done
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219::getRetryCount() {
+  return ina219_retryCount;
+}
+
 /**************************************************************************/
 /*! 
     @brief  Gets the raw bus voltage (16-bit signed integer, so +-32767)
 */
 /**************************************************************************/
 int16_t Adafruit_INA219::getBusVoltage_raw() {
+  return getBusVoltage_raw(NULL);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the raw bus voltage in mV and returns the CNVR and OVF
+            bits that come with the same register read in 'flags'
+            (INA219_BUSVOLTAGE_CNVR / INA219_BUSVOLTAGE_OVF).
+
+    @note   CNVR is set once a new conversion is complete and cleared
+            by reading the POWER register or writing the CONFIG
+            register.  OVF is set when the CURRENT or POWER calculations
+            are out of range, which usually means the PGA gain is too
+            high for the load.
+*/
+/**************************************************************************/
+int16_t Adafruit_INA219::getBusVoltage_raw(uint8_t *flags) {
+  Call call(this);
   uint16_t value;
-  wireReadRegister(INA219_REG_BUSVOLTAGE, &value);
+  uint8_t status = wireReadRegister(INA219_REG_BUSVOLTAGE, &value);
+  return decodeBusVoltage(value, status, flags);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Splits a bus voltage register value into mV and flags.
+            'status' is that of the read, the 0 of a failed read is
+            not a measurement and isn't checked against the alarms.
+*/
+/**************************************************************************/
+int16_t Adafruit_INA219::decodeBusVoltage(uint16_t value, uint8_t status, uint8_t *flags) {
+  ina219_flags = value & INA219_BUSVOLTAGE_FLAGS_MASK;
+  if (flags != NULL)
+    *flags = ina219_flags;
+
+  // an overflowing CURRENT/POWER calculation means the shunt range is
+  // too small, the next conversion will use the larger one
+  if (status == INA219_OK && ina219_autoRange && (ina219_flags & INA219_BUSVOLTAGE_OVF))
+    stepGain(1);
 
   // Shift to the right 3 to drop CNVR and OVF and multiply by LSB
-  return (int16_t)((value >> 3) * 4);
+  int16_t bus = (int16_t)((value >> 3) * 4);
+  if (status == INA219_OK && (ina219_alarmEnabled & INA219_ALARM_UNDERVOLTAGE))
+    checkAlarm(1, -bus, ina219_alarmTrip[1], ina219_alarmClear[1]);
+  return bus;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the CNVR and OVF flags seen on the last bus voltage
+            read, without touching the bus
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219::getLastFlags() {
+  return ina219_flags;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads a new shunt/bus voltage pair only if a conversion has
+            completed since the previous call.  Returns false (after a
+            single bus voltage read) when the chip still holds the
+            sample that was already returned, so high-rate loops never
+            process the same conversion twice.
+
+    @note   CNVR is cleared by reading the POWER register, so a fresh
+            sample costs one extra read.  The value is discarded here,
+            use getPower_raw() afterwards if it is needed as it stays
+            valid until the next conversion (in software power mode
+            the POWER register is still what clears CNVR).
+*/
+/**************************************************************************/
+bool Adafruit_INA219::readConversion(int16_t *shunt_raw, int16_t *bus_raw) {
+  Call call(this);
+  uint8_t flags;
+  int16_t bus;
+
+  // the register is sampled somewhere during the read, take the middle
+  uint32_t before = micros();
+  uint32_t errors = ina219_errorCount;
+  bus = getBusVoltage_raw(&flags);
+  uint32_t poll = before + (micros() - before) / 2;
+  if (ina219_errorCount != errors)
+    return false;
+
+  if (!(flags & INA219_BUSVOLTAGE_CNVR)) {
+    ina219_pollTime_us = poll;
+    ina219_pollIdle = true;
+    return false;
+  }
+
+  timestampConversion(poll);
+  ina219_pollTime_us = poll;
+  ina219_pollIdle = false;
+
+  *bus_raw = bus;
+  *shunt_raw = getShuntVoltage_raw();
+
+  // clear CNVR so the next call only succeeds on a new conversion
+  uint16_t power;
+  wireReadRegister(INA219_REG_POWER, &power);
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Timestamps the conversion readConversion() just found.  When
+            the previous poll saw CNVR clear the conversion completed
+            between the two polls, so the edge is put in the middle
+            with half the gap as error.  Otherwise it completed some
+            time before this poll and only the poll time is known.
+            Intervals between consecutive bracketed edges feed the
+            jitter statistics; a gap over 1.5 conversion cycles means a
+            conversion was missed and is not counted.
+*/
+/**************************************************************************/
+void Adafruit_INA219::timestampConversion(uint32_t poll_us) {
+  uint32_t edge = poll_us;
+  bool bracketed = ina219_pollIdle;
+
+  if (bracketed) {
+    uint32_t gap = poll_us - ina219_pollTime_us;
+    edge = ina219_pollTime_us + gap / 2;
+    ina219_edgeError_us = (gap + 1) / 2;
+  } else {
+    ina219_edgeError_us = INA219_EDGE_UNKNOWN;
+  }
+
+  if (bracketed && ina219_edgeValid) {
+    uint32_t interval = edge - ina219_edge_us;
+    if (interval * 2 <= getConversionTime_us() * 3) {
+      // Welford's running mean and variance
+      ina219_jitCount++;
+      float delta = interval - ina219_jitMean_us;
+      ina219_jitMean_us += delta / ina219_jitCount;
+      ina219_jitM2 += delta * (interval - ina219_jitMean_us);
+      if (interval < ina219_jitMin_us)
+        ina219_jitMin_us = interval;
+      if (interval > ina219_jitMax_us)
+        ina219_jitMax_us = interval;
+    }
+  }
+
+  ina219_edge_us = edge;
+  ina219_edgeValid = bracketed;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the micros() at which the conversion returned by the
+            last successful readConversion() completed
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219::getConversionEdge_us() {
+  return ina219_edge_us;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the +- error of getConversionEdge_us(), or
+            INA219_EDGE_UNKNOWN when the previous poll didn't see CNVR
+            clear.  Poll faster than the conversion rate to keep it low.
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219::getConversionEdgeError_us() {
+  return ina219_edgeError_us;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the statistics of the intervals between conversion
+            edges since the last resetJitter()
+*/
+/**************************************************************************/
+void Adafruit_INA219::getJitter(ina219_jitter_t *jitter) {
+  jitter->count = ina219_jitCount;
+  jitter->min_us = ina219_jitCount ? ina219_jitMin_us : 0;
+  jitter->max_us = ina219_jitMax_us;
+  jitter->mean_us = ina219_jitMean_us;
+  jitter->stddev_us = (ina219_jitCount > 1) ? sqrt(ina219_jitM2 / (ina219_jitCount - 1)) : 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Clears the jitter statistics
+*/
+/**************************************************************************/
+void Adafruit_INA219::resetJitter() {
+  ina219_jitCount = 0;
+  ina219_jitMin_us = 0xFFFFFFFF;
+  ina219_jitMax_us = 0;
+  ina219_jitMean_us = 0;
+  ina219_jitM2 = 0;
 }
 
 /**************************************************************************/
@@ -541,9 +1155,237 @@ int16_t Adafruit_INA219::getBusVoltage_raw() {
 */
 /**************************************************************************/
 int16_t Adafruit_INA219::getShuntVoltage_raw() {
+  Call call(this);
   uint16_t value;
-  wireReadRegister(INA219_REG_SHUNTVOLTAGE, &value);
-  return (int16_t)value;
+  uint8_t status = wireReadRegister(INA219_REG_SHUNTVOLTAGE, &value);
+  return trackShuntVoltage((int16_t)value, status);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Runs the shunt voltage hooks (auto ranging, adaptive
+            averaging, over-current alarm) on a new reading, 'status'
+            being that of the read
+*/
+/**************************************************************************/
+int16_t Adafruit_INA219::trackShuntVoltage(int16_t shunt, uint8_t status) {
+  // the 0 of a failed read would step the gain down and look like noise
+  if (status == INA219_OK && ina219_autoRange)
+    shunt = autoRange(shunt, &status);
+  if (status == INA219_OK && ina219_adaptRate_Hz)
+    adaptAveraging(shunt);
+  if (status == INA219_OK && (ina219_alarmEnabled & INA219_ALARM_OVERCURRENT))
+    checkAlarm(0, shunt, ina219_alarmTrip[0], ina219_alarmClear[0]);
+  return shunt;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Enables or disables automatic PGA gain ranging.  When enabled
+            every shunt voltage read is checked against the full scale
+            of the current PGA range and the gain is stepped with
+            hysteresis (see INA219_AUTORANGE_UP / INA219_AUTORANGE_DOWN).
+
+    @note   The shunt voltage register has a 10uV LSB whatever the PGA
+            setting, and the chip derives CURRENT and POWER from it
+            through the calibration value, so ina219_calValue and the
+            current/power LSBs stay valid across range switches and the
+            converted values are continuous.
+*/
+/**************************************************************************/
+void Adafruit_INA219::setAutoRange(bool enable) {
+  ina219_autoRange = enable;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the number of PGA range switches done so far
+*/
+/**************************************************************************/
+uint16_t Adafruit_INA219::getRangeSwitches() {
+  return ina219_rangeSwitches;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the extra time in us the last upward range switch
+            added to a shunt voltage read (new config write, one full
+            conversion and the read again)
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219::getRangeSwitchLatency_us() {
+  return ina219_rangeLatency_us;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Moves the PGA gain one range up (dir > 0) or down (dir < 0)
+            with a single write of the shadowed config.  Returns false
+            if already at the end of the range.
+*/
+/**************************************************************************/
+bool Adafruit_INA219::stepGain(int8_t dir) {
+  uint16_t gain = ina219_config & INA219_CONFIG_GAIN_MASK;
+
+  if (dir > 0) {
+    if (gain == INA219_CONFIG_GAIN_8_320MV)
+      return false;
+    gain += INA219_CONFIG_GAIN_2_80MV;
+  } else {
+    if (gain == INA219_CONFIG_GAIN_1_40MV)
+      return false;
+    gain -= INA219_CONFIG_GAIN_2_80MV;
+  }
+
+  writeConfig((ina219_config & ~INA219_CONFIG_GAIN_MASK) | gain);
+  ina219_rangeSwitches++;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Checks a shunt voltage reading against the current PGA range.
+            A reading close to full scale may be clipped, so the range
+            is stepped up and the value read again once the new
+            conversion is done.  A small reading steps the range down
+            and is returned as is since it is valid in both ranges.
+            'status' is updated if that read fails.
+*/
+/**************************************************************************/
+int16_t Adafruit_INA219::autoRange(int16_t value, uint8_t *status) {
+  uint32_t start = micros();
+  bool switched = false;
+
+  for (;;) {
+    // full scale is 4000 x 10uV at 40mV, doubling for each range
+    int16_t fullScale = 4000 << ((ina219_config & INA219_CONFIG_GAIN_MASK) >> 11);
+    int16_t level = (value < 0) ? -value : value;
+
+    if (level >= (int16_t)((int32_t)fullScale * INA219_AUTORANGE_UP / 8)) {
+      if (!stepGain(1))
+        break;
+      // a held config isn't on the chip yet, the next conversion uses it
+      if (ina219_configHeld)
+        break;
+      switched = true;
+      delayLong_us(getConversionTime_us());
+      uint16_t raw;
+      *status = wireReadRegister(INA219_REG_SHUNTVOLTAGE, &raw);
+      value = (int16_t)raw;
+      if (*status != INA219_OK)
+        break;
+      continue;
+    }
+
+    if (level < (int16_t)((int32_t)fullScale * INA219_AUTORANGE_DOWN / 8))
+      stepGain(-1);
+    break;
+  }
+
+  if (switched)
+    ina219_rangeLatency_us = micros() - start;
+  return value;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Enables adaptive ADC averaging.  The shunt and bus ADCs are
+            set to average 1 to 128 samples depending on the variance of
+            the last INA219_ADAPT_WINDOW shunt readings, never going
+            below 'minRate_Hz' conversion cycles per second.  A quiet
+            rail climbs one averaging step per window, a noisy one drops
+            straight back to single samples.  Pass 0 to disable.
+
+    @note   This overrides setAmpInstant()/setAmpAverage() and
+            setVoltInstant()/setVoltAverage() while enabled.
+*/
+/**************************************************************************/
+void Adafruit_INA219::setAdaptiveAveraging(uint16_t minRate_Hz) {
+  ina219_adaptRate_Hz = minRate_Hz;
+  ina219_adaptCount = 0;
+  if (minRate_Hz)
+    setAveragingLevel(0);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the averaging picked by adaptive averaging, as the
+            log2 of the number of samples (0 = 1 sample ... 7 = 128)
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219::getAveragingLevel() {
+  return ina219_adaptLevel;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sets both ADCs to 12-bit with 2^level samples averaged in a
+            single config write
+*/
+/**************************************************************************/
+void Adafruit_INA219::setAveragingLevel(uint8_t level) {
+  uint16_t adc = 0x08 | level;
+  uint16_t config = ina219_config & ~(INA219_CONFIG_SADCRES_MASK | INA219_CONFIG_BADCRES_MASK);
+
+  ina219_adaptLevel = level;
+  writeConfig(config | (adc << 3) | (adc << 7));
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Feeds a shunt reading to adaptive averaging.  Only readings
+            at least one conversion cycle apart are used so polling
+            faster than the chip converts doesn't count the same sample
+            twice.  Deviations are taken from the first reading of the
+            window and clamped so the sums fit in 32 bits.
+*/
+/**************************************************************************/
+void Adafruit_INA219::adaptAveraging(int16_t value) {
+  uint32_t now = micros();
+  uint32_t cycle_us = getConversionTime_us();
+
+  if (ina219_adaptCount && (now - ina219_adaptTime_us) < cycle_us)
+    return;
+  ina219_adaptTime_us = now;
+
+  if (ina219_adaptCount == 0) {
+    ina219_adaptFirst = value;
+    ina219_adaptSum = 0;
+    ina219_adaptSumSq = 0;
+  }
+
+  int32_t d = (int32_t)value - ina219_adaptFirst;
+  if (d > 2047) d = 2047;
+  if (d < -2047) d = -2047;
+  ina219_adaptSum += d;
+  ina219_adaptSumSq += d * d;
+
+  if (++ina219_adaptCount < INA219_ADAPT_WINDOW)
+    return;
+  ina219_adaptCount = 0;
+
+  // variance in LSB^2, n^2 * var = n * sum(d^2) - sum(d)^2
+  int32_t n = INA219_ADAPT_WINDOW;
+  int32_t var = (n * ina219_adaptSumSq - ina219_adaptSum * ina219_adaptSum) / (n * n);
+
+  // heaviest averaging that still meets the caller's sample rate,
+  // shunt and bus times scale the same way with the level
+  uint8_t maxLevel = 0;
+  uint32_t budget_us = 1000000UL / ina219_adaptRate_Hz;
+  uint32_t base_us = cycle_us >> ina219_adaptLevel;
+  while (maxLevel < 7 && (base_us << (maxLevel + 1)) <= budget_us)
+    maxLevel++;
+
+  uint8_t level = ina219_adaptLevel;
+  if (var >= INA219_ADAPT_VAR_HIGH)
+    level = 0;
+  else if (var <= INA219_ADAPT_VAR_LOW && level < maxLevel)
+    level++;
+  if (level > maxLevel)
+    level = maxLevel;
+
+  if (level != ina219_adaptLevel)
+    setAveragingLevel(level);
 }
 
 /**************************************************************************/
@@ -552,18 +1394,38 @@ int16_t Adafruit_INA219::getShuntVoltage_raw() {
 */
 /**************************************************************************/
 int16_t Adafruit_INA219::getCurrent_raw() {
+  Call call(this);
+  if (ina219_softwarePower)
+    return currentFromShunt(getShuntVoltage_raw());
+
+  // the shunt voltage wasn't read, check the over-current alarm here
+  int16_t current;
+  uint8_t status = readCurrentRegister(&current);
+  if (status == INA219_OK && (ina219_alarmEnabled & INA219_ALARM_OVERCURRENT))
+    checkAlarm(0, current, ina219_alarmCurrentTrip, ina219_alarmCurrentClear);
+  return current;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads the CURRENT register, rewriting the calibration first.
+            Returns the status of the first access that failed.
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219::readCurrentRegister(int16_t *current) {
   uint16_t value;
 
   // Sometimes a sharp load will reset the INA219, which will
   // reset the cal register, meaning CURRENT and POWER will
   // not be available ... avoid this by always setting a cal
   // value even if it's an unfortunate extra step
-  wireWriteRegister(INA219_REG_CALIBRATION, ina219_calValue);
+  uint8_t status = wireWriteRegister(INA219_REG_CALIBRATION, ina219_calValue);
 
   // Now we can safely read the CURRENT register!
-  wireReadRegister(INA219_REG_CURRENT, &value);
+  uint8_t readStatus = wireReadRegister(INA219_REG_CURRENT, &value);
   
-  return (int16_t)value;
+  *current = (int16_t)value;
+  return (status != INA219_OK) ? status : readStatus;
 }
  
 /**************************************************************************/
@@ -572,11 +1434,67 @@ int16_t Adafruit_INA219::getCurrent_raw() {
 */
 /**************************************************************************/
 int16_t Adafruit_INA219::getPower_raw() {
+  Call call(this);
   uint16_t value;
-  wireReadRegister(INA219_REG_POWER, &value);
+
+  if (ina219_softwarePower) {
+    uint32_t errors = ina219_errorCount;
+    int16_t current = currentFromShunt(getShuntVoltage_raw());
+    // the chip's POWER = CURRENT * BUSVOLTAGE / 5000, with BUSVOLTAGE
+    // in 4mV steps
+    int32_t power = (int32_t)current * getBusVoltage_raw();
+    if (ina219_errorCount == errors && (ina219_alarmEnabled & INA219_ALARM_OVERPOWER))
+      checkAlarm(2, power, ina219_alarmTrip[2], ina219_alarmClear[2]);
+    return (int16_t)(power / 20000);
+  }
+
+  uint8_t status = wireReadRegister(INA219_REG_POWER, &value);
+  if (status == INA219_OK && (ina219_alarmEnabled & INA219_ALARM_OVERPOWER))
+    checkAlarm(2, (int32_t)(int16_t)value * 20000, ina219_alarmTrip[2], ina219_alarmClear[2]);
   return (int16_t)value;
 }
  
+/**************************************************************************/
+/*! 
+    @brief  Converts a current in mA to the shunt voltage register value
+            that gives it with the current calibration, so thresholds
+            can be compared against raw readings.  The chip computes
+            CURRENT = SHUNTVOLTAGE * Cal / 4096.
+*/
+/**************************************************************************/
+int16_t Adafruit_INA219::shuntRawFromCurrent_mA(float current_mA) {
+  if (ina219_calValue == 0 || ina219_currentLsb_mA == 0)
+    return 0;
+
+  float value = current_mA / ina219_currentLsb_mA * 4096 / ina219_calValue;
+  if (value > 32767)
+    return 32767;
+  if (value < -32767)
+    return -32767;
+  return (int16_t)value;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the mA per bit of the CURRENT register for the
+            calibration in use, to convert raw samples elsewhere
+*/
+/**************************************************************************/
+float Adafruit_INA219::getCurrentLsb_mA() {
+  return ina219_currentLsb_mA;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the mA per bit of the SHUNT register for the
+            calibration in use, 0 if there is none, for limits too fine
+            for shuntRawFromCurrent_mA() to round to whole bits
+*/
+/**************************************************************************/
+float Adafruit_INA219::getShuntLsb_mA() {
+  return ina219_currentLsb_mA * ina219_calValue / 4096;
+}
+
 /**************************************************************************/
 /*! 
     @brief  Gets the shunt voltage in mV (so +-327mV)
@@ -617,11 +1535,114 @@ float Adafruit_INA219::getCurrent_mA() {
 */
 /**************************************************************************/
 float Adafruit_INA219::getPower_mW() {
+  if (ina219_softwarePower) {
+    ina219_sample_t sample;
+    getSample(&sample);
+    return getPower_mW(&sample);
+  }
+
   float valueDec = getPower_raw(); //
   valueDec *= ina219_powerLsb_mW;
   return valueDec;
 }
 
+/**************************************************************************/
+/*! 
+    @brief  Makes the driver compute current and power from the shunt
+            and bus voltages instead of reading the CURRENT and POWER
+            registers.  The current is computed the way the chip does
+            it, CURRENT = SHUNTVOLTAGE * Cal / 4096, so it is identical
+            to the register without the calibration write, and the
+            power is kept in current LSB x 1mV, 20000 times finer than
+            the POWER register.  A full getSample() then takes 2 reads
+            instead of 4 reads and a write.
+*/
+/**************************************************************************/
+void Adafruit_INA219::setSoftwarePower(bool enable) {
+  ina219_softwarePower = enable;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Computes the CURRENT register value for a raw shunt voltage
+            in integer math, |shunt| < 2^15 and Cal < 2^16 fit in 32 bits
+*/
+/**************************************************************************/
+int16_t Adafruit_INA219::currentFromShunt(int16_t shunt) {
+  return (int16_t)((int32_t)shunt * (int32_t)ina219_calValue / 4096);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads shunt voltage, bus voltage, current and power in one
+            go.  Power is in current LSB x 1mV in both modes so samples
+            can be mixed; use getCurrent_mA(sample) / getPower_mW(sample)
+            to convert.
+*/
+/**************************************************************************/
+void Adafruit_INA219::getSample(ina219_sample_t *sample) {
+  Call call(this);
+  getSampleVoltages(sample);
+  getSampleCurrentPower(sample);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  First half of getSample(): reads the shunt and bus voltages
+            and the flags into 'sample'
+*/
+/**************************************************************************/
+void Adafruit_INA219::getSampleVoltages(ina219_sample_t *sample) {
+  Call call(this);
+  uint32_t errors = ina219_errorCount;
+  sample->shunt = getShuntVoltage_raw();
+  sample->bus = getBusVoltage_raw(&sample->flags);
+  ina219_sampleValid = (ina219_errorCount == errors);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Second half of getSample(): completes the 'sample' of the
+            last getSampleVoltages() with current and power, computed
+            in software power mode, else read from the CURRENT and
+            POWER registers (which hold the same conversion until the
+            next one completes)
+*/
+/**************************************************************************/
+void Adafruit_INA219::getSampleCurrentPower(ina219_sample_t *sample) {
+  Call call(this);
+  if (ina219_softwarePower) {
+    sample->current = currentFromShunt(sample->shunt);
+    sample->power = (int32_t)sample->current * sample->bus;
+    // a failed read left a 0 in the product
+    if (ina219_sampleValid && (ina219_alarmEnabled & INA219_ALARM_OVERPOWER))
+      checkAlarm(2, sample->power, ina219_alarmTrip[2], ina219_alarmClear[2]);
+  } else {
+    // over-current was checked on the shunt voltage already
+    readCurrentRegister(&sample->current);
+    // PowerLSB = 20 * CurrentLSB, i.e. 20000 x (CurrentLSB x 1mV)
+    sample->power = (int32_t)getPower_raw() * 20000;
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Converts the current of a sample to mA
+*/
+/**************************************************************************/
+float Adafruit_INA219::getCurrent_mA(const ina219_sample_t *sample) {
+  return sample->current * ina219_currentLsb_mA;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Converts the power of a sample to mW
+*/
+/**************************************************************************/
+float Adafruit_INA219::getPower_mW(const ina219_sample_t *sample) {
+  return sample->power * ina219_currentLsb_mA / 1000;
+}
+
 /**************************************************************************/
 /*! 
     @brief  Change the config register so that the INA219 returns current
@@ -629,16 +1650,8 @@ float Adafruit_INA219::getPower_mW() {
 */
 /**************************************************************************/
 void Adafruit_INA219::setAmpInstant() {
-  uint16_t value;
-
-  // get the current configuration data
-  wireReadRegister(INA219_REG_CONFIG, &value);
-
   // change out the bits to average 1 samples at 12 bits per sample
-  value = value & ~INA219_CONFIG_SADCRES_MASK | INA219_CONFIG_SADCRES_12BIT_1S_532US ;
-
-  // write the changed config value back again
-  wireWriteRegister(INA219_REG_CONFIG, value);
+  writeConfig((ina219_config & ~INA219_CONFIG_SADCRES_MASK) | INA219_CONFIG_SADCRES_12BIT_1S_532US);
 }
 
 /**************************************************************************/
@@ -648,21 +1661,24 @@ void Adafruit_INA219::setAmpInstant() {
 */
 /**************************************************************************/
 void Adafruit_INA219::setAmpAverage() {
-  uint16_t value;
-
-  // get the current configuration data
-  wireReadRegister(INA219_REG_CONFIG, &value);
-
   // change out the bits to average 128 samples at 12 bits per sample
-  value = value & ~INA219_CONFIG_SADCRES_MASK | INA219_CONFIG_SADCRES_12BIT_128S_69MS;
-
-  // write the changed config value back again
-  wireWriteRegister(INA219_REG_CONFIG, value);
+  writeConfig((ina219_config & ~INA219_CONFIG_SADCRES_MASK) | INA219_CONFIG_SADCRES_12BIT_128S_69MS);
 
   delay(69); // Max 12-bit 128S conversion time is 69mS per sample, but
   // read can happen more frequently
 }
 
+/**************************************************************************/
+/*! 
+    @brief  Change the config register so that the INA219 returns current
+            measurement values from single 9-bit samples (84us), for
+            software oversampling with Adafruit_INA219_Decimator.
+*/
+/**************************************************************************/
+void Adafruit_INA219::setAmpFast() {
+  writeConfig((ina219_config & ~INA219_CONFIG_SADCRES_MASK) | INA219_CONFIG_SADCRES_9BIT_1S_84US);
+}
+
 /**************************************************************************/
 /*! 
     @brief  Change the config register so that the INA219 returns voltage
@@ -670,16 +1686,8 @@ void Adafruit_INA219::setAmpAverage() {
 */
 /**************************************************************************/
 void Adafruit_INA219::setVoltInstant() {
-  uint16_t value;
-
-  // get the current configuration data
-  wireReadRegister(INA219_REG_CONFIG, &value);
-
   // change out the bits to average 1 samples at 12 bits per sample
-  value = value & ~INA219_CONFIG_BADCRES_MASK | INA219_CONFIG_BADCRES_12BIT ;
-
-  // write the changed config value back again
-  wireWriteRegister(INA219_REG_CONFIG, value);
+  writeConfig((ina219_config & ~INA219_CONFIG_BADCRES_MASK) | INA219_CONFIG_BADCRES_12BIT);
 }
 
 /**************************************************************************/
@@ -689,18 +1697,405 @@ void Adafruit_INA219::setVoltInstant() {
 */
 /**************************************************************************/
 void Adafruit_INA219::setVoltAverage() {
+  // change out the bits to average 128 samples at 12 bits per sample
+  writeConfig((ina219_config & ~INA219_CONFIG_BADCRES_MASK) | INA219_CONFIG_BADCRES_12BIT_128S_69MS);
+
+  delay(69); // Max 12-bit 128S conversion time is 69mS per sample, but
+  // read can happen more frequently
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Keeps the chip powered down between measurements taken every
+            'period_ms', call dutyCycle() from the main loop to run it.
+            The ADC settings are those of the shadowed config.  Pass 0
+            to go back to the configured continuous mode.
+*/
+/**************************************************************************/
+void Adafruit_INA219::setDutyCycle(uint32_t period_ms) {
+  ina219_dutyPeriod_ms = period_ms;
+  ina219_dutyAwake = false;
+
+  if (period_ms == 0) {
+    writeConfig(ina219_config);
+    return;
+  }
+
+  // the shadow keeps the configured mode, only the chip is switched
+  wireWriteRegister(INA219_REG_CONFIG,
+                    (ina219_config & ~INA219_CONFIG_MODE_MASK) | INA219_CONFIG_MODE_POWERDOWN);
+  ina219_dutyNext_ms = millis() + period_ms;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns how long before a sample is due the chip has to be
+            woken up: power-down recovery plus one conversion cycle
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219::dutyCycleLead_us() {
+  return INA219_POWERDOWN_RECOVERY_US + getConversionTime_us();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Runs the duty cycle, non-blocking.  Wakes the chip into a
+            triggered conversion just early enough for it to be done
+            when the sample is due, reads it and powers the chip down
+            again, each transition being a single config write.  Returns
+            true when a new shunt/bus pair was stored.
+*/
+/**************************************************************************/
+bool Adafruit_INA219::dutyCycle(int16_t *shunt_raw, int16_t *bus_raw) {
+  Call call(this);
+  if (ina219_dutyPeriod_ms == 0)
+    return false;
+
+  uint32_t lead_us = dutyCycleLead_us();
+
+  if (!ina219_dutyAwake) {
+    uint32_t lead_ms = (lead_us + 999) / 1000;
+    if ((int32_t)(millis() - (ina219_dutyNext_ms - lead_ms)) < 0)
+      return false;
+
+    // continuous modes have the triggered mode in their lower 2 bits
+    uint16_t mode = ina219_config & INA219_CONFIG_MODE_SANDBVOLT_TRIGGERED;
+    if (mode == INA219_CONFIG_MODE_POWERDOWN)
+      mode = INA219_CONFIG_MODE_SANDBVOLT_TRIGGERED;
+    wireWriteRegister(INA219_REG_CONFIG, (ina219_config & ~INA219_CONFIG_MODE_MASK) | mode);
+    ina219_dutyWake_us = micros();
+    ina219_dutyAwake = true;
+    return false;
+  }
+
+  uint32_t awake_us = micros() - ina219_dutyWake_us;
+  if (awake_us < lead_us)
+    return false;
+
+  uint8_t flags;
+  int16_t bus = getBusVoltage_raw(&flags);
+  // give the conversion up to twice its nominal time before skipping it
+  if (!(flags & INA219_BUSVOLTAGE_CNVR) && awake_us < 2 * lead_us)
+    return false;
+
+  bool ready = flags & INA219_BUSVOLTAGE_CNVR;
+  if (ready) {
+    *bus_raw = bus;
+    *shunt_raw = getShuntVoltage_raw();
+  }
+
+  wireWriteRegister(INA219_REG_CONFIG,
+                    (ina219_config & ~INA219_CONFIG_MODE_MASK) | INA219_CONFIG_MODE_POWERDOWN);
+  ina219_dutyAwake = false;
+
+  // stay on the period grid, skipping the slots that were missed
+  uint32_t now = millis();
+  do {
+    ina219_dutyNext_ms += ina219_dutyPeriod_ms;
+  } while ((int32_t)(now - ina219_dutyNext_ms) >= 0);
+
+  return ready;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the average supply current in uA of the chip when
+            duty cycled at 'period_ms' with the current ADC settings and
+            I2C clock.  The chip is active from the wake-up write until
+            the power-down write, i.e. recovery, one conversion cycle
+            and the three transactions of the read (127 SCL periods).
+*/
+/**************************************************************************/
+float Adafruit_INA219::getDutyCycleSupply_uA(uint32_t period_ms) {
+  float active_us = dutyCycleLead_us() + 127.0 * 1000000 / ina219_i2cClock;
+  float period_us = period_ms * 1000.0;
+
+  if (period_us <= active_us)
+    return INA219_SUPPLY_ACTIVE_UA;
+  return INA219_SUPPLY_POWERDOWN_UA +
+         (INA219_SUPPLY_ACTIVE_UA - INA219_SUPPLY_POWERDOWN_UA) * active_us / period_us;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sets the operating mode (INA219_CONFIG_MODE_*) in a single
+            config write.  INA219_CONFIG_MODE_SVOLT_CONTINUOUS and
+            INA219_CONFIG_MODE_BVOLT_CONTINUOUS convert a single channel,
+            so a new value comes twice as often as in the default
+            shunt and bus mode for the same ADC settings.
+*/
+/**************************************************************************/
+void Adafruit_INA219::setMode(uint16_t mode) {
+  writeConfig((ina219_config & ~INA219_CONFIG_MODE_MASK) | (mode & INA219_CONFIG_MODE_MASK));
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Starts a single conversion: switches the shadowed config to
+            the matching triggered mode and writes it, a config write
+            being what starts a triggered conversion.  The result stays
+            in the registers until the next trigger.  Returns false if
+            the write failed.  A held config change goes out with it.
+
+    @note   The chip stays in triggered mode, later config changes
+            included; setMode() with a continuous mode goes back.
+*/
+/**************************************************************************/
+bool Adafruit_INA219::triggerConversion() {
+  Call call(this);
+  // continuous modes have the triggered mode in their lower 2 bits
+  uint16_t mode = ina219_config & INA219_CONFIG_MODE_SANDBVOLT_TRIGGERED;
+  if (mode == INA219_CONFIG_MODE_POWERDOWN)
+    mode = INA219_CONFIG_MODE_SANDBVOLT_TRIGGERED;
+
+  ina219_config = (ina219_config & ~INA219_CONFIG_MODE_MASK) | mode;
+  if (wireWriteRegister(INA219_REG_CONFIG, ina219_config) != INA219_OK)
+    return false;
+  ina219_configPending = false;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Holds back config writes, e.g. the range and averaging
+            changes of auto-range and adaptive averaging, while 'hold'
+            is set: in triggered mode a config write starts a new
+            conversion and clears CNVR, which must not happen while
+            the result of the last one is being read.  The changes are
+            kept in the shadowed config and written by the next
+            triggerConversion(), or when released if still pending.
+*/
+/**************************************************************************/
+void Adafruit_INA219::holdConfig(bool hold) {
+  Call call(this);
+  ina219_configHeld = hold;
+  if (!hold && ina219_configPending) {
+    ina219_configPending = false;
+    writeConfig(ina219_config);
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Fast read path for the single channel modes: returns the raw
+            shunt voltage in shunt-only mode, the raw bus voltage in mV
+            in bus-only mode (flags kept for getLastFlags()).  The
+            register pointer is only written when it doesn't already
+            point at the channel, so back to back calls are a single
+            2-byte read with no calibration write.
+
+    @note   A chip reset (e.g. from a sharp load) moves the pointer back
+            to the config register behind the driver's back.  Call
+            setMode() again if readings look wrong.
+*/
+/**************************************************************************/
+int16_t Adafruit_INA219::readChannel_raw() {
+  Call call(this);
   uint16_t value;
+  uint8_t mode = ina219_config & INA219_CONFIG_MODE_MASK;
+  uint8_t reg = (mode == INA219_CONFIG_MODE_BVOLT_CONTINUOUS ||
+                 mode == INA219_CONFIG_MODE_BVOLT_TRIGGERED) ?
+                INA219_REG_BUSVOLTAGE : INA219_REG_SHUNTVOLTAGE;
+
+  uint8_t status;
+  if (ina219_pointer == reg)
+    status = wireReadPointed(&value);
+  else
+    status = wireReadRegister(reg, &value);
 
-  // get the current configuration data
-  wireReadRegister(INA219_REG_CONFIG, &value);
+  if (reg == INA219_REG_BUSVOLTAGE)
+    return decodeBusVoltage(value, status, NULL);
+  return trackShuntVoltage((int16_t)value, status);
+}
 
-  // change out the bits to average 128 samples at 12 bits per sample
-  value = value & ~INA219_CONFIG_BADCRES_MASK | INA219_CONFIG_BADCRES_12BIT_128S_69MS ;
+/**************************************************************************/
+/*! 
+    @brief  Reads 'count' raw values of one register (shunt voltage, bus
+            voltage in mV, current or power) into 'buffer', one every
+            'interval_us' (0 = back to back).  The register pointer is
+            set once and the calibration written once for the CURRENT
+            and POWER registers, then each sample is a single 2-byte
+            read with no float math.  If 'timestamps_us' is given, the
+            micros() of each read is stored there.  Returns the number
+            of values read, less than 'count' if a read failed.
+
+    @note   The shunt voltage hooks (auto ranging, adaptive averaging)
+            and the alarms don't run during a burst.
+*/
+/**************************************************************************/
+uint16_t Adafruit_INA219::readN(uint8_t reg, int16_t *buffer, uint16_t count,
+                                uint32_t interval_us, uint32_t *timestamps_us) {
+  uint16_t value;
 
-  // write the changed config value back again
-  wireWriteRegister(INA219_REG_CONFIG, value);
+  if (reg == INA219_REG_CURRENT || reg == INA219_REG_POWER)
+    wireWriteRegister(INA219_REG_CALIBRATION, ina219_calValue);
+
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < count; i++) {
+    if (interval_us) {
+      uint32_t due = start + i * interval_us;
+      while ((int32_t)(micros() - due) < 0)
+        ;
+    }
+    if (timestamps_us != NULL)
+      timestamps_us[i] = micros();
+
+    uint8_t status;
+    if (ina219_pointer == reg)
+      status = wireReadPointed(&value);
+    else
+      status = wireReadRegister(reg, &value);
+    if (status != INA219_OK)
+      return i;
+
+    if (reg == INA219_REG_BUSVOLTAGE)
+      value = (value >> 3) * 4;
+    buffer[i] = (int16_t)value;
+  }
+  return count;
+}
 
-  delay(69); // Max 12-bit 128S conversion time is 69mS per sample, but
-  // read can happen more frequently
+/**************************************************************************/
+/*! 
+    @brief  Limits a threshold to the 16-bit register range
+*/
+/**************************************************************************/
+static int16_t clampRaw(float value) {
+  if (value > 32767)
+    return 32767;
+  if (value < -32767)
+    return -32767;
+  return (int16_t)value;
 }
 
+/**************************************************************************/
+/*! 
+    @brief  Raises INA219_ALARM_OVERCURRENT once 'debounce' consecutive
+            readings are above 'current_mA', and clears it once as many
+            are below 'current_mA' - 'hysteresis_mA'.  It is checked on
+            every shunt voltage reading, and on CURRENT register reads
+            when the shunt voltage isn't read.
+
+    @note   The thresholds are converted to raw units with the current
+            calibration, set the alarms after setCalibration_*().
+*/
+/**************************************************************************/
+void Adafruit_INA219::setOverCurrentAlarm(float current_mA, float hysteresis_mA, uint8_t debounce) {
+  if (ina219_currentLsb_mA == 0)
+    return;
+  ina219_alarmCurrentTrip = clampRaw(current_mA / ina219_currentLsb_mA);
+  ina219_alarmCurrentClear = clampRaw((current_mA - hysteresis_mA) / ina219_currentLsb_mA);
+  setAlarm(0, shuntRawFromCurrent_mA(current_mA),
+           shuntRawFromCurrent_mA(current_mA - hysteresis_mA), debounce);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Raises INA219_ALARM_UNDERVOLTAGE once 'debounce' consecutive
+            bus voltage readings are below 'bus_V', and clears it once
+            as many are above 'bus_V' + 'hysteresis_V'
+*/
+/**************************************************************************/
+void Adafruit_INA219::setUnderVoltageAlarm(float bus_V, float hysteresis_V, uint8_t debounce) {
+  // negated so every alarm trips above its threshold
+  setAlarm(1, -(int32_t)(bus_V * 1000), -(int32_t)((bus_V + hysteresis_V) * 1000), debounce);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Raises INA219_ALARM_OVERPOWER once 'debounce' consecutive
+            power values are above 'power_mW', and clears it once as
+            many are below 'power_mW' - 'hysteresis_mW'.  It is checked
+            wherever the driver reads or computes power.
+*/
+/**************************************************************************/
+void Adafruit_INA219::setOverPowerAlarm(float power_mW, float hysteresis_mW, uint8_t debounce) {
+  if (ina219_currentLsb_mA == 0)
+    return;
+  // in current LSB x 1mV, as ina219_sample_t.power
+  setAlarm(2, (int32_t)(power_mW * 1000 / ina219_currentLsb_mA),
+           (int32_t)((power_mW - hysteresis_mW) * 1000 / ina219_currentLsb_mA), debounce);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Stores an alarm's raw thresholds and enables it, inactive
+*/
+/**************************************************************************/
+void Adafruit_INA219::setAlarm(uint8_t index, int32_t trip, int32_t clear, uint8_t debounce) {
+  uint8_t alarm = 1 << index;
+
+  ina219_alarmTrip[index] = trip;
+  ina219_alarmClear[index] = clear;
+  ina219_alarmDebounce[index] = debounce ? debounce : 1;
+  ina219_alarmCount[index] = 0;
+  ina219_alarmActive &= ~alarm;
+  ina219_alarmEnabled |= alarm;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Disables the given INA219_ALARM_* alarms and clears them
+*/
+/**************************************************************************/
+void Adafruit_INA219::disableAlarms(uint8_t alarms) {
+  ina219_alarmEnabled &= ~alarms;
+  ina219_alarmActive &= ~alarms;
+  ina219_alarmEvents &= ~alarms;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sets a function called from the read that raises or clears
+            an alarm, with the INA219_ALARM_* bit and its new state
+*/
+/**************************************************************************/
+void Adafruit_INA219::setAlarmCallback(void (*callback)(uint8_t alarm, bool active)) {
+  ina219_alarmCallback = callback;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the INA219_ALARM_* bits of the active alarms
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219::getAlarms() {
+  return ina219_alarmActive;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the INA219_ALARM_* bits of the alarms raised since the
+            last call, even if they have cleared since, and resets them
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219::getAlarmEvents() {
+  uint8_t events = ina219_alarmEvents;
+  ina219_alarmEvents = 0;
+  return events;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Debounces one raw value against an alarm's thresholds: only
+            the bound that would change the state is compared
+*/
+/**************************************************************************/
+void Adafruit_INA219::checkAlarm(uint8_t index, int32_t value, int32_t trip, int32_t clear) {
+  uint8_t alarm = 1 << index;
+  bool active = ina219_alarmActive & alarm;
+
+  if (active ? (value >= clear) : (value <= trip)) {
+    ina219_alarmCount[index] = 0;
+    return;
+  }
+  if (++ina219_alarmCount[index] < ina219_alarmDebounce[index])
+    return;
+
+  ina219_alarmCount[index] = 0;
+  ina219_alarmActive ^= alarm;
+  if (!active)
+    ina219_alarmEvents |= alarm;
+  if (ina219_alarmCallback != NULL)
+    ina219_alarmCallback(alarm, !active);
+}
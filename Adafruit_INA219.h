@@ -17,13 +17,26 @@
 */
 /**************************************************************************/
 
+#ifndef _ADAFRUIT_INA219_H_
+#define _ADAFRUIT_INA219_H_
+
 #if ARDUINO >= 100
  #include "Arduino.h"
 #else
  #include "WProgram.h"
 #endif
 
-#include <Wire.h>
+// ATtiny85 (Trinket, Gemma) has no TWI, use the USI based TinyWireM
+#ifdef __AVR_ATtiny85__
+ #include <TinyWireM.h>
+ #define Wire TinyWireM
+#else
+ #include <Wire.h>
+#endif
+
+#if ARDUINO >= 157 && !defined(__AVR_ATtiny85__)
+ #define INA219_WIRE_SETCLOCK                      // Wire.setClock() available
+#endif
 
 #define INA219_DEBUG 0
 
@@ -32,6 +45,22 @@
     -----------------------------------------------------------------------*/
     #define INA219_ADDRESS                         (0x40)    // 1000000 (A0+A1=GND)
     #define INA219_READ                            (0x01)
+    /*---------------------------------------------------------------------*/
+    #define INA219_I2C_CLOCK_STANDARD              (100000)  // Standard mode, Wire default
+    #define INA219_I2C_CLOCK_FAST                  (400000)  // Fast mode
+    #define INA219_I2C_CLOCK_HIGHSPEED             (2560000) // High-speed mode maximum
+    #define INA219_I2C_HS_MASTER_CODE              (0x04)    // 0000 1xxx, sent as 7-bit address
+
+    /*---------------------------------------------------------------------*/
+    #define INA219_OK                              (0)
+    #define INA219_ERR_NACK                        (1)       // Address or data not acknowledged
+    #define INA219_ERR_SHORT_READ                  (2)       // Fewer bytes than requested
+    #define INA219_ERR_TIMEOUT                     (3)       // Bus stuck or call deadline passed
+    #define INA219_ERR_BUS                         (4)       // Other bus error
+
+// Define INA219_I2C_HS_CAPABLE if the Wire implementation keeps the bus
+// (repeated start) after the NACKed HS master code and its setClock()
+// goes above 400kHz.  Without it clocks are limited to fast mode.
 /*=========================================================================*/
 
 /*=========================================================================
@@ -80,6 +109,21 @@
     #define INA219_CONFIG_MODE_SVOLT_CONTINUOUS    (0x0005)
     #define INA219_CONFIG_MODE_BVOLT_CONTINUOUS    (0x0006)
     #define INA219_CONFIG_MODE_SANDBVOLT_CONTINUOUS (0x0007)	
+    /*---------------------------------------------------------------------*/
+    #define INA219_AUTORANGE_UP                    (7)       // Step gain up above 7/8 of full scale
+    #define INA219_AUTORANGE_DOWN                  (3)       // Step gain down below 3/8 of full scale
+    #define INA219_ADAPT_WINDOW                    (8)       // Shunt readings per variance estimate
+    #define INA219_ADAPT_VAR_LOW                   (4)       // Average more below this variance (LSB^2)
+    #define INA219_ADAPT_VAR_HIGH                  (100)     // Back to single samples above it (LSB^2)
+    /*---------------------------------------------------------------------*/
+    #define INA219_POWERDOWN_RECOVERY_US           (40)      // Power-down to first conversion
+    #define INA219_SUPPLY_ACTIVE_UA                (1000)    // Quiescent current, max
+    #define INA219_SUPPLY_POWERDOWN_UA             (15)      // Power-down current, max
+    /*---------------------------------------------------------------------*/
+    #define INA219_ALARM_OVERCURRENT               (0x01)
+    #define INA219_ALARM_UNDERVOLTAGE              (0x02)
+    #define INA219_ALARM_OVERPOWER                 (0x04)
+    #define INA219_ALARM_COUNT                     (3)
 /*=========================================================================*/
 
 /*=========================================================================
@@ -92,6 +136,10 @@
     BUS VOLTAGE REGISTER (R)
     -----------------------------------------------------------------------*/
     #define INA219_REG_BUSVOLTAGE                  (0x02)
+    /*---------------------------------------------------------------------*/
+    #define INA219_BUSVOLTAGE_CNVR                 (0x0002)  // Conversion Ready
+    #define INA219_BUSVOLTAGE_OVF                  (0x0001)  // Math Overflow Flag
+    #define INA219_BUSVOLTAGE_FLAGS_MASK           (0x0003)  // CNVR and OVF
 /*=========================================================================*/
 
 /*=========================================================================
@@ -112,11 +160,38 @@
     #define INA219_REG_CALIBRATION                 (0x05)
 /*=========================================================================*/
 
+    #define INA219_REG_NONE                        (0xFF)    // Register pointer unknown
+    #define INA219_EDGE_UNKNOWN                    (0xFFFFFFFF) // Conversion edge error unknown
+
+typedef struct {
+  int16_t shunt;      ///< Raw shunt voltage, 10uV per bit
+  int16_t bus;        ///< Raw bus voltage in mV
+  int16_t current;    ///< Current in current LSBs, as the CURRENT register
+  int32_t power;      ///< Power in current LSB x 1mV
+  uint8_t flags;      ///< CNVR / OVF from the bus voltage read
+} ina219_sample_t;
+
+typedef struct {
+  uint32_t count;     ///< Conversion intervals measured
+  uint32_t min_us;    ///< Shortest interval
+  uint32_t max_us;    ///< Longest interval
+  float mean_us;      ///< Mean interval
+  float stddev_us;    ///< Standard deviation, i.e. the sampling jitter
+} ina219_jitter_t;
+
 class Adafruit_INA219{
  public:
   Adafruit_INA219(uint8_t addr = INA219_ADDRESS);
   void begin(void);
   void begin(uint8_t addr);
+  uint32_t setI2CClock(uint32_t clock_Hz);
+  uint32_t getI2CClock(void);
+  // I2C error handling
+  void setRetryPolicy(uint8_t retries, uint32_t deadline_us);
+  void setBusRecovery(void (*recover)(void));
+  uint8_t getLastError(void);
+  uint32_t getErrorCount(void);
+  uint32_t getRetryCount(void);
   void setCalibration_32V_2A(void);
   void setCalibration_32V_1A(void);
   void setCalibration_16V_400mA(void);
@@ -132,21 +207,154 @@ class Adafruit_INA219{
   float getPower_mW(void);
   void setAmpInstant(void);
   void setAmpAverage(void);
+  void setAmpFast(void);
   void setVoltInstant(void);
   void setVoltAverage(void);
+  // raw register access, CNVR/OVF are returned through 'flags' when given
+  int16_t getBusVoltage_raw(void);
+  int16_t getBusVoltage_raw(uint8_t *flags);
+  int16_t getShuntVoltage_raw(void);
+  int16_t getCurrent_raw(void);
+  int16_t getPower_raw(void);
+  uint8_t getLastFlags(void);
+  bool readConversion(int16_t *shunt_raw, int16_t *bus_raw);
+  uint32_t getConversionEdge_us(void);
+  uint32_t getConversionEdgeError_us(void);
+  void getJitter(ina219_jitter_t *jitter);
+  void resetJitter(void);
+  uint32_t getConversionTime_us(void);
+  int16_t shuntRawFromCurrent_mA(float current_mA);
+  float getCurrentLsb_mA(void);
+  float getShuntLsb_mA(void);
+  // automatic PGA gain ranging
+  void setAutoRange(bool enable);
+  uint16_t getRangeSwitches(void);
+  uint32_t getRangeSwitchLatency_us(void);
+  // adaptive ADC averaging
+  void setAdaptiveAveraging(uint16_t minRate_Hz);
+  uint8_t getAveragingLevel(void);
+  // duty-cycled power-down
+  void setDutyCycle(uint32_t period_ms);
+  bool dutyCycle(int16_t *shunt_raw, int16_t *bus_raw);
+  float getDutyCycleSupply_uA(uint32_t period_ms);
+  // single channel modes
+  void setMode(uint16_t mode);
+  int16_t readChannel_raw(void);
+  bool triggerConversion(void);
+  void holdConfig(bool hold);
+  // full samples, optionally computing current and power in software
+  void setSoftwarePower(bool enable);
+  void getSample(ina219_sample_t *sample);
+  // the same in two steps, e.g. to read the voltages of several chips first
+  void getSampleVoltages(ina219_sample_t *sample);
+  void getSampleCurrentPower(ina219_sample_t *sample);
+  float getCurrent_mA(const ina219_sample_t *sample);
+  float getPower_mW(const ina219_sample_t *sample);
+  // bulk acquisition of one register
+  uint16_t readN(uint8_t reg, int16_t *buffer, uint16_t count,
+                 uint32_t interval_us = 0, uint32_t *timestamps_us = NULL);
+  // threshold alarms on the raw readings
+  void setOverCurrentAlarm(float current_mA, float hysteresis_mA, uint8_t debounce = 1);
+  void setUnderVoltageAlarm(float bus_V, float hysteresis_V, uint8_t debounce = 1);
+  void setOverPowerAlarm(float power_mW, float hysteresis_mW, uint8_t debounce = 1);
+  void disableAlarms(uint8_t alarms);
+  void setAlarmCallback(void (*callback)(uint8_t alarm, bool active));
+  uint8_t getAlarms(void);
+  uint8_t getAlarmEvents(void);
 
  private:
   uint8_t ina219_i2caddr;
+  uint32_t ina219_i2cClock;
+  uint8_t ina219_retries;
+  uint32_t ina219_deadline_us;
+  uint8_t ina219_callDepth;
+  uint32_t ina219_callStart_us;
+  void (*ina219_busRecovery)(void);
+  uint8_t ina219_lastError;
+  uint32_t ina219_errorCount;
+  uint32_t ina219_retryCount;
+  uint8_t ina219_flags;
+  uint8_t ina219_pointer;
+  uint16_t ina219_config;
+  bool ina219_configHeld;
+  bool ina219_configPending;
+  bool ina219_autoRange;
+  uint16_t ina219_rangeSwitches;
+  uint32_t ina219_rangeLatency_us;
+  uint16_t ina219_adaptRate_Hz;
+  uint8_t ina219_adaptLevel;
+  uint8_t ina219_adaptCount;
+  int16_t ina219_adaptFirst;
+  int32_t ina219_adaptSum;
+  int32_t ina219_adaptSumSq;
+  uint32_t ina219_adaptTime_us;
+  uint32_t ina219_dutyPeriod_ms;
+  uint32_t ina219_dutyNext_ms;
+  uint32_t ina219_dutyWake_us;
+  bool ina219_dutyAwake;
+  bool ina219_softwarePower;
+  bool ina219_sampleValid;
+  uint32_t ina219_pollTime_us;
+  bool ina219_pollIdle;
+  uint32_t ina219_edge_us;
+  uint32_t ina219_edgeError_us;
+  bool ina219_edgeValid;
+  uint32_t ina219_jitCount;
+  uint32_t ina219_jitMin_us;
+  uint32_t ina219_jitMax_us;
+  float ina219_jitMean_us;
+  float ina219_jitM2;
+  uint8_t ina219_alarmEnabled;
+  uint8_t ina219_alarmActive;
+  uint8_t ina219_alarmEvents;
+  uint8_t ina219_alarmDebounce[INA219_ALARM_COUNT];
+  uint8_t ina219_alarmCount[INA219_ALARM_COUNT];
+  int32_t ina219_alarmTrip[INA219_ALARM_COUNT];   // raw units, under-voltage negated
+  int32_t ina219_alarmClear[INA219_ALARM_COUNT];
+  int16_t ina219_alarmCurrentTrip;                // over-current in CURRENT register units
+  int16_t ina219_alarmCurrentClear;
+  void (*ina219_alarmCallback)(uint8_t alarm, bool active);
   uint32_t ina219_calValue;
   // The following multipliers are used to convert raw current and power
   // values to mA and mW, taking into account the current config settings
   float ina219_currentLsb_mA;
   float ina219_powerLsb_mW;
   
-  void wireWriteRegister(uint8_t reg, uint16_t value);
-  void wireReadRegister(uint8_t reg, uint16_t *value);
-  int16_t getBusVoltage_raw(void);
-  int16_t getShuntVoltage_raw(void);
-  int16_t getCurrent_raw(void);
-  int16_t getPower_raw(void);
+  // Marks a public call for its lifetime, so the retry deadline counts
+  // from its start across all the register accesses it makes
+  class Call {
+   public:
+    Call(Adafruit_INA219 *ina219);
+    ~Call();
+   private:
+    Adafruit_INA219 *call_ina219;
+  };
+  friend class Call;
+
+  uint32_t wireCallStart(void);
+  bool wireExpired(uint32_t start);
+  void wireBeginBus(void);
+  void wireArmTimeout(uint32_t start);
+  uint8_t wireStatus(uint8_t result);
+  uint8_t wireWriteOnce(uint8_t reg, const uint8_t *data, uint8_t len, uint32_t start);
+  uint8_t wireReadOnce(uint16_t *value, uint32_t start);
+  bool wireRetry(uint8_t status, uint8_t attempt, uint32_t start);
+  uint8_t wireWriteRegister(uint8_t reg, uint16_t value);
+  uint8_t wireReadRegister(uint8_t reg, uint16_t *value);
+  uint8_t wireReadPointed(uint16_t *value);
+  int16_t decodeBusVoltage(uint16_t value, uint8_t status, uint8_t *flags);
+  int16_t trackShuntVoltage(int16_t shunt, uint8_t status);
+  void writeConfig(uint16_t config);
+  bool stepGain(int8_t dir);
+  int16_t autoRange(int16_t value, uint8_t *status);
+  void setAveragingLevel(uint8_t level);
+  void adaptAveraging(int16_t value);
+  uint32_t dutyCycleLead_us(void);
+  int16_t currentFromShunt(int16_t shunt);
+  uint8_t readCurrentRegister(int16_t *current);
+  void setAlarm(uint8_t index, int32_t trip, int32_t clear, uint8_t debounce);
+  void checkAlarm(uint8_t index, int32_t value, int32_t trip, int32_t clear);
+  void timestampConversion(uint32_t poll_us);
 };
+
+#endif
@@ -0,0 +1,225 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Capture.cpp
+	@license  BSD (see license.txt)
+	
+	Threshold-triggered transient capture for the INA219
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+#include <math.h>
+
+#include "Adafruit_INA219_Capture.h"
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates a capture on an already configured INA219, using
+            a caller supplied buffer of pre + post samples
+*/
+/**************************************************************************/
+Adafruit_INA219_Capture::Adafruit_INA219_Capture(Adafruit_INA219 *ina219,
+    ina219_capture_t *buffer, uint16_t pre, uint16_t post) {
+  capture_ina219 = ina219;
+  capture_buffer = buffer;
+  capture_pre = pre;
+  capture_post = post ? post : 1;   // the trigger sample itself
+  capture_size = capture_pre + capture_post;
+  clearTriggers();
+  arm();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Triggers when the current goes above 'current_mA'.  The
+            limit is converted to a raw shunt value with the calibration
+            in use, so set the calibration first.
+*/
+/**************************************************************************/
+void Adafruit_INA219_Capture::setOverCurrent(float current_mA) {
+  capture_shuntLimit = capture_ina219->shuntRawFromCurrent_mA(current_mA);
+  capture_enabled |= INA219_TRIG_OVERCURRENT;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Triggers when the bus voltage drops below 'bus_V'
+*/
+/**************************************************************************/
+void Adafruit_INA219_Capture::setUnderVoltage(float bus_V) {
+  capture_busLimit = (int16_t)(bus_V * 1000);
+  capture_enabled |= INA219_TRIG_UNDERVOLTAGE;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Triggers when the current changes faster than
+            'current_mA_per_ms' between two conversions, either way.
+            The limit is kept in shunt bits per second so limits below
+            one bit per ms still hold; returns false, leaving the
+            trigger off, if it rounds to nothing or there is no
+            calibration yet.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Capture::setSlewRate(float current_mA_per_ms) {
+  float lsb_mA = capture_ina219->getShuntLsb_mA();
+  if (lsb_mA <= 0)
+    return false;
+
+  float limit = fabs(current_mA_per_ms) * 1000 / lsb_mA + 0.5;
+  if (limit < 1)
+    return false;
+  capture_slewLimit = (limit > 4294967295.0) ? 0xFFFFFFFF : (uint32_t)limit;
+  capture_enabled |= INA219_TRIG_SLEWRATE;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Disables all trigger conditions
+*/
+/**************************************************************************/
+void Adafruit_INA219_Capture::clearTriggers() {
+  capture_enabled = 0;
+  capture_shuntLimit = 0;
+  capture_busLimit = 0;
+  capture_slewLimit = 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Empties the buffer and waits for the next trigger
+*/
+/**************************************************************************/
+void Adafruit_INA219_Capture::arm() {
+  capture_head = 0;
+  capture_count = 0;
+  capture_remaining = 0;
+  capture_cause = 0;
+  capture_triggered = false;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Takes the next conversion, if there is one, and checks the
+            trigger conditions.  Call it as often as possible; reads
+            that find no new conversion cost a single register read.
+            Returns true once the capture is complete, after which
+            nothing is overwritten until arm() is called again.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Capture::poll() {
+  int16_t shunt, bus;
+
+  if (isDone())
+    return true;
+  if (!capture_ina219->readConversion(&shunt, &bus))
+    return false;
+
+  uint32_t now = micros();
+
+  if (!capture_triggered && capture_enabled) {
+    uint8_t cause = 0;
+
+    if ((capture_enabled & INA219_TRIG_OVERCURRENT) && shunt > capture_shuntLimit)
+      cause |= INA219_TRIG_OVERCURRENT;
+    if ((capture_enabled & INA219_TRIG_UNDERVOLTAGE) && bus < capture_busLimit)
+      cause |= INA219_TRIG_UNDERVOLTAGE;
+    if ((capture_enabled & INA219_TRIG_SLEWRATE) && capture_count) {
+      const ina219_capture_t *last =
+        &capture_buffer[(capture_head + capture_size - 1) % capture_size];
+      int32_t delta = (int32_t)shunt - last->shunt;
+      uint32_t dt_us = now - last->time_us;
+      if (delta < 0)
+        delta = -delta;
+      // |dShunt| * 1e6 / dt_us > limit without dividing
+      if ((uint64_t)delta * 1000000 > (uint64_t)capture_slewLimit * dt_us)
+        cause |= INA219_TRIG_SLEWRATE;
+    }
+
+    if (cause) {
+      capture_triggered = true;
+      capture_cause = cause;
+      capture_remaining = capture_post;
+    }
+  }
+
+  ina219_capture_t *slot = &capture_buffer[capture_head];
+  slot->time_us = now;
+  slot->shunt = shunt;
+  slot->bus = bus;
+  if (++capture_head == capture_size)
+    capture_head = 0;
+  if (capture_count < capture_size)
+    capture_count++;
+
+  if (capture_triggered)
+    capture_remaining--;
+  return isDone();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns true once a trigger condition fired
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Capture::isTriggered() {
+  return capture_triggered;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns true once all post-trigger samples are taken
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Capture::isDone() {
+  return capture_triggered && capture_remaining == 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the INA219_TRIG_* conditions that fired
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219_Capture::getTriggerCause() {
+  return capture_cause;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the number of samples in the buffer, at most
+            pre + post (less if the trigger came early)
+*/
+/**************************************************************************/
+uint16_t Adafruit_INA219_Capture::available() {
+  return capture_count;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the index, for getSample(), of the sample that fired
+            the trigger once the capture is done
+*/
+/**************************************************************************/
+uint16_t Adafruit_INA219_Capture::getTriggerIndex() {
+  return capture_count - capture_post;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns sample 'index' in time order, 0 being the oldest
+*/
+/**************************************************************************/
+const ina219_capture_t *Adafruit_INA219_Capture::getSample(uint16_t index) {
+  if (index >= capture_count)
+    return NULL;
+  return &capture_buffer[(capture_head + capture_size - capture_count + index) % capture_size];
+}
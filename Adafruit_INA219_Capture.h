@@ -0,0 +1,75 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Capture.h
+	@license  BSD (see license.txt)
+	
+	Threshold-triggered transient capture for the INA219
+
+	Works like an oscilloscope in normal trigger mode: every new
+	conversion goes into a circular buffer supplied by the caller
+	and when a trigger condition fires, 'pre' samples before it and
+	'post' samples from it on are frozen for retrieval.  Nothing is
+	allocated and the trigger checks are integer compares on the
+	raw register values.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_CAPTURE_H_
+#define _ADAFRUIT_INA219_CAPTURE_H_
+
+#include "Adafruit_INA219.h"
+
+/*=========================================================================
+    TRIGGER CONDITIONS
+    -----------------------------------------------------------------------*/
+    #define INA219_TRIG_OVERCURRENT                (0x01)    // Current above limit
+    #define INA219_TRIG_UNDERVOLTAGE               (0x02)    // Bus voltage below limit
+    #define INA219_TRIG_SLEWRATE                   (0x04)    // |dI/dt| above limit
+/*=========================================================================*/
+
+typedef struct {
+  uint32_t time_us;   ///< micros() when the conversion was read
+  int16_t shunt;      ///< Raw shunt voltage, 10uV per bit
+  int16_t bus;        ///< Raw bus voltage in mV
+} ina219_capture_t;
+
+class Adafruit_INA219_Capture{
+ public:
+  // 'buffer' must hold pre + post samples
+  Adafruit_INA219_Capture(Adafruit_INA219 *ina219, ina219_capture_t *buffer,
+                          uint16_t pre, uint16_t post);
+  void setOverCurrent(float current_mA);
+  void setUnderVoltage(float bus_V);
+  bool setSlewRate(float current_mA_per_ms);
+  void clearTriggers(void);
+  void arm(void);
+  bool poll(void);
+  bool isTriggered(void);
+  bool isDone(void);
+  uint8_t getTriggerCause(void);
+  uint16_t available(void);
+  uint16_t getTriggerIndex(void);
+  const ina219_capture_t *getSample(uint16_t index);
+
+ private:
+  Adafruit_INA219 *capture_ina219;
+  ina219_capture_t *capture_buffer;
+  uint16_t capture_pre;
+  uint16_t capture_post;
+  uint16_t capture_size;
+  uint16_t capture_head;      // next slot to write
+  uint16_t capture_count;     // valid samples in the buffer
+  uint16_t capture_remaining; // post-trigger samples still to take
+  uint8_t capture_enabled;
+  uint8_t capture_cause;
+  bool capture_triggered;
+  int16_t capture_shuntLimit;
+  int16_t capture_busLimit;
+  uint32_t capture_slewLimit; // shunt LSBs per second
+};
+
+#endif
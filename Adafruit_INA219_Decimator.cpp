@@ -0,0 +1,148 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Decimator.cpp
+	@license  BSD (see license.txt)
+	
+	Software oversampling and decimation of raw INA219 shunt readings
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+#include "Adafruit_INA219_Decimator.h"
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates a decimation stage reducing the rate by
+            2^log2Ratio with a boxcar or 2nd order CIC filter.  The
+            ratio is clamped to 2^INA219_DECIM_MAX_LOG2_RATIO and so
+            order x log2Ratio stays within INA219_DECIM_MAX_GAIN_BITS.
+*/
+/**************************************************************************/
+Adafruit_INA219_Decimator::Adafruit_INA219_Decimator(uint8_t log2Ratio, uint8_t order) {
+  decim_order = (order == INA219_DECIM_CIC2) ? INA219_DECIM_CIC2 : INA219_DECIM_BOXCAR;
+  if (log2Ratio * decim_order > INA219_DECIM_MAX_GAIN_BITS)
+    log2Ratio = INA219_DECIM_MAX_GAIN_BITS / decim_order;
+  if (log2Ratio > INA219_DECIM_MAX_LOG2_RATIO)
+    log2Ratio = INA219_DECIM_MAX_LOG2_RATIO;
+  decim_log2Ratio = log2Ratio;
+  reset();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Clears the filter state and the sample counters
+*/
+/**************************************************************************/
+void Adafruit_INA219_Decimator::reset() {
+  decim_phase = 0;
+  decim_integ[0] = decim_integ[1] = 0;
+  decim_comb[0] = decim_comb[1] = 0;
+  decim_fast = 0;
+  decim_output = 0;
+  decim_inputs = 0;
+  decim_outputs = 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Feeds one raw shunt reading (10uV per bit).  Returns true
+            when a new decimated value is available from getOutput(),
+            that is once every 2^log2Ratio readings after the filter has
+            settled (the first order-1 outputs are dropped).
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Decimator::push(int16_t raw) {
+  decim_fast = raw;
+  decim_inputs++;
+
+  decim_integ[0] += (uint32_t)(int32_t)raw;
+  decim_integ[1] += decim_integ[0];
+
+  if (++decim_phase < ((uint16_t)1 << decim_log2Ratio))
+    return false;
+  decim_phase = 0;
+
+  // combs run at the output rate
+  uint32_t y = decim_integ[decim_order - 1];
+  for (uint8_t i = 0; i < decim_order; i++) {
+    uint32_t prev = decim_comb[i];
+    decim_comb[i] = y;
+    y -= prev;
+  }
+
+  // the filter gain is 2^(order x log2Ratio), keep FRAC_BITS of it
+  int32_t sum = (int32_t)y;
+  int8_t shift = decim_order * decim_log2Ratio - INA219_DECIM_FRAC_BITS;
+  if (shift > 0)
+    decim_output = (sum + ((int32_t)1 << (shift - 1))) >> shift;
+  else
+    decim_output = sum * ((int32_t)1 << -shift);
+
+  return ++decim_outputs >= decim_order;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the last raw reading, i.e. the high-rate stream
+*/
+/**************************************************************************/
+int16_t Adafruit_INA219_Decimator::getFast() {
+  return decim_fast;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the last decimated value in 10uV per bit with
+            INA219_DECIM_FRAC_BITS fractional bits
+*/
+/**************************************************************************/
+int32_t Adafruit_INA219_Decimator::getOutput() {
+  return decim_output;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the decimation ratio R
+*/
+/**************************************************************************/
+uint16_t Adafruit_INA219_Decimator::getRatio() {
+  return (uint16_t)1 << decim_log2Ratio;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the number of raw readings pushed since reset()
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Decimator::getInputCount() {
+  return decim_inputs;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the number of decimated values produced since
+            reset(), including the ones dropped while settling.  It is
+            always exactly getInputCount() / getRatio().
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Decimator::getOutputCount() {
+  return decim_outputs;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the output period for a given input period, e.g.
+            the 84us of a 9-bit shunt-only conversion
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Decimator::getOutputPeriod_us(uint32_t inputPeriod_us) {
+  return inputPeriod_us << decim_log2Ratio;
+}
@@ -0,0 +1,64 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Decimator.h
+	@license  BSD (see license.txt)
+	
+	Software oversampling and decimation of raw INA219 shunt readings
+
+	The INA219 only averages at 12-bit.  Feeding fast 9-bit (84us)
+	conversions from getShuntVoltage_raw() through this stage gives
+	both the high-rate stream and a lower-rate, higher-resolution
+	stream from the same acquisition.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_DECIMATOR_H_
+#define _ADAFRUIT_INA219_DECIMATOR_H_
+
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+/*=========================================================================
+    DECIMATION FILTERS
+    -----------------------------------------------------------------------*/
+    #define INA219_DECIM_BOXCAR                    (1)       // Sum of the last R samples (CIC order 1)
+    #define INA219_DECIM_CIC2                      (2)       // CIC order 2, better alias rejection
+    #define INA219_DECIM_MAX_GAIN_BITS             (16)      // order x log2(R) limit, keeps 32-bit math
+    #define INA219_DECIM_MAX_LOG2_RATIO            (15)      // R limit, the phase and getRatio() are 16-bit
+    #define INA219_DECIM_FRAC_BITS                 (4)       // Fractional bits of the decimated output
+/*=========================================================================*/
+
+class Adafruit_INA219_Decimator{
+ public:
+  Adafruit_INA219_Decimator(uint8_t log2Ratio = 4, uint8_t order = INA219_DECIM_BOXCAR);
+  void reset(void);
+  bool push(int16_t raw);
+  int16_t getFast(void);
+  int32_t getOutput(void);
+  uint16_t getRatio(void);
+  uint32_t getInputCount(void);
+  uint32_t getOutputCount(void);
+  uint32_t getOutputPeriod_us(uint32_t inputPeriod_us);
+
+ private:
+  uint8_t decim_log2Ratio;
+  uint8_t decim_order;
+  uint16_t decim_phase;
+  // integrators and comb delays, wrapping 2's complement arithmetic
+  // is what makes a CIC filter exact so these are unsigned
+  uint32_t decim_integ[2];
+  uint32_t decim_comb[2];
+  int16_t decim_fast;
+  int32_t decim_output;
+  uint32_t decim_inputs;
+  uint32_t decim_outputs;
+};
+
+#endif
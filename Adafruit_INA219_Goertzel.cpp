@@ -0,0 +1,184 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Goertzel.cpp
+	@license  BSD (see license.txt)
+	
+	Streaming Goertzel filter bank on raw INA219 shunt readings
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+#include <math.h>
+
+#include "Adafruit_INA219_Goertzel.h"
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates a bank for readings taken at 'sampleRate_Hz',
+            reporting every 'blockSize' readings (at most
+            INA219_GOERTZEL_MAX_BLOCK).  The frequency resolution is
+            sampleRate_Hz / blockSize.
+*/
+/**************************************************************************/
+Adafruit_INA219_Goertzel::Adafruit_INA219_Goertzel(float sampleRate_Hz, uint16_t blockSize) {
+  if (blockSize > INA219_GOERTZEL_MAX_BLOCK)
+    blockSize = INA219_GOERTZEL_MAX_BLOCK;
+  if (blockSize < 4 * INA219_GOERTZEL_MIN_BINS_FROM_EDGE)
+    blockSize = 4 * INA219_GOERTZEL_MIN_BINS_FROM_EDGE;
+  goertzel_rate_Hz = sampleRate_Hz;
+  goertzel_n = blockSize;
+  goertzel_bins = 0;
+  reset();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Adds a bin at 'frequency_Hz', computing its coefficient
+            now so push() stays in integer math.  Returns the bin
+            index, or -1 if the bank is full or the frequency is within
+            INA219_GOERTZEL_MIN_BINS_FROM_EDGE bins of DC or Nyquist,
+            where the resonator gain would overflow 32 bits.
+*/
+/**************************************************************************/
+int8_t Adafruit_INA219_Goertzel::addBin(float frequency_Hz) {
+  float binWidth_Hz = goertzel_rate_Hz / goertzel_n;
+  float edge_Hz = INA219_GOERTZEL_MIN_BINS_FROM_EDGE * binWidth_Hz;
+
+  if (goertzel_bins >= INA219_GOERTZEL_MAX_BINS ||
+      frequency_Hz < edge_Hz || frequency_Hz > goertzel_rate_Hz / 2 - edge_Hz)
+    return -1;
+
+  float w = 2 * M_PI * frequency_Hz / goertzel_rate_Hz;
+  goertzel_freq[goertzel_bins] = frequency_Hz;
+  goertzel_coeff[goertzel_bins] = (int32_t)lround(2 * cos(w) * (1L << INA219_GOERTZEL_Q));
+  goertzel_s1[goertzel_bins] = goertzel_s2[goertzel_bins] = 0;
+  goertzel_amplitude[goertzel_bins] = 0;
+  return goertzel_bins++;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Restarts the current block, bins are kept
+*/
+/**************************************************************************/
+void Adafruit_INA219_Goertzel::reset() {
+  goertzel_phase = 0;
+  goertzel_dc = 0;
+  goertzel_sum = 0;
+  goertzel_blocks = 0;
+  for (uint8_t b = 0; b < goertzel_bins; b++) {
+    goertzel_s1[b] = goertzel_s2[b] = 0;
+    goertzel_amplitude[b] = 0;
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Feeds one raw shunt reading (10uV per bit).  Returns true at
+            the end of each block, when getAmplitude_*() are updated.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Goertzel::push(int16_t raw) {
+  // the first block has no mean yet, start from its first reading
+  if (goertzel_blocks == 0 && goertzel_phase == 0)
+    goertzel_dc = raw;
+  goertzel_sum += raw;
+
+  // removing the DC keeps it from leaking into bins between the
+  // block's harmonics and keeps the resonators small
+  int32_t x = (int32_t)raw - goertzel_dc;
+  for (uint8_t b = 0; b < goertzel_bins; b++) {
+    // |x| < 2^16 and sin(w) >= 8pi/N away from the edges bound |s1| by
+    // N^2 2^16 / 8pi < 2^30, so with |coeff| < 2^15 the Q14 product
+    // splits into two exact 32-bit ones: the high part of s1 times the
+    // coefficient, plus the low 14 bits times it, shifted
+    int32_t s1 = goertzel_s1[b];
+    int32_t lo = s1 & ((1L << INA219_GOERTZEL_Q) - 1);
+    int32_t s = x + goertzel_coeff[b] * ((s1 - lo) >> INA219_GOERTZEL_Q)
+                + ((goertzel_coeff[b] * lo) >> INA219_GOERTZEL_Q) - goertzel_s2[b];
+    goertzel_s2[b] = goertzel_s1[b];
+    goertzel_s1[b] = s;
+  }
+
+  if (++goertzel_phase < goertzel_n)
+    return false;
+
+  // |X|^2 = s1^2 + s2^2 - 2cos(w) s1 s2, and a sine of peak amplitude A
+  // gives |X| = A N / 2
+  for (uint8_t b = 0; b < goertzel_bins; b++) {
+    int64_t s1 = goertzel_s1[b], s2 = goertzel_s2[b];
+    int64_t power = s1 * s1 + s2 * s2 - ((goertzel_coeff[b] * s1 >> INA219_GOERTZEL_Q) * s2);
+    goertzel_amplitude[b] = (power > 0) ? 2 * sqrt((float)power) / goertzel_n : 0;
+    goertzel_s1[b] = goertzel_s2[b] = 0;
+  }
+  goertzel_dc = goertzel_sum / goertzel_n;
+  goertzel_sum = 0;
+  goertzel_phase = 0;
+  goertzel_blocks++;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the peak ripple amplitude of a bin over the last block,
+            in shunt LSBs (10uV)
+*/
+/**************************************************************************/
+float Adafruit_INA219_Goertzel::getAmplitude_raw(uint8_t bin) {
+  return (bin < goertzel_bins) ? goertzel_amplitude[bin] : 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the peak ripple amplitude of a bin in mV across the
+            shunt; divide by the shunt resistance for the current
+*/
+/**************************************************************************/
+float Adafruit_INA219_Goertzel::getAmplitude_mV(uint8_t bin) {
+  return getAmplitude_raw(bin) * 0.01;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the frequency a bin was added at, 0 for no such bin
+*/
+/**************************************************************************/
+float Adafruit_INA219_Goertzel::getFrequency_Hz(uint8_t bin) {
+  return (bin < goertzel_bins) ? goertzel_freq[bin] : 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the number of bins added
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219_Goertzel::getBinCount() {
+  return goertzel_bins;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the number of samples per block, which sets the bin
+            width to the sample rate / block size
+*/
+/**************************************************************************/
+uint16_t Adafruit_INA219_Goertzel::getBlockSize() {
+  return goertzel_n;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the number of complete blocks since reset()
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Goertzel::getBlockCount() {
+  return goertzel_blocks;
+}
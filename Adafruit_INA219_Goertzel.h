@@ -0,0 +1,67 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Goertzel.h
+	@license  BSD (see license.txt)
+	
+	Streaming Goertzel filter bank on raw INA219 shunt readings, to
+	measure supply ripple at known switching frequencies
+
+	Each bin is a second order resonator run on every reading in
+	32-bit integer math with a Q14 coefficient, two 32-bit multiplies
+	per reading and bin; once per block of N readings the energy of
+	each bin, in 64 bits, gives the ripple amplitude.  Feed it fast 9-bit (84us) conversions, see
+	Adafruit_INA219::setAmpFast(), at a known sample rate.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_GOERTZEL_H_
+#define _ADAFRUIT_INA219_GOERTZEL_H_
+
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+/*=========================================================================
+    GOERTZEL BANK
+    -----------------------------------------------------------------------*/
+    #define INA219_GOERTZEL_MAX_BINS               (8)
+    #define INA219_GOERTZEL_MAX_BLOCK              (512)     // keeps the resonators in 32 bits
+    #define INA219_GOERTZEL_MIN_BINS_FROM_EDGE     (4)       // bins away from DC and Nyquist
+    #define INA219_GOERTZEL_Q                      (14)      // coefficient fractional bits
+/*=========================================================================*/
+
+class Adafruit_INA219_Goertzel{
+ public:
+  Adafruit_INA219_Goertzel(float sampleRate_Hz, uint16_t blockSize = 256);
+  int8_t addBin(float frequency_Hz);
+  void reset(void);
+  bool push(int16_t raw);
+  float getAmplitude_raw(uint8_t bin);
+  float getAmplitude_mV(uint8_t bin);
+  float getFrequency_Hz(uint8_t bin);
+  uint8_t getBinCount(void);
+  uint16_t getBlockSize(void);
+  uint32_t getBlockCount(void);
+
+ private:
+  float goertzel_rate_Hz;
+  uint16_t goertzel_n;
+  uint16_t goertzel_phase;
+  uint8_t goertzel_bins;
+  int16_t goertzel_dc;                       // mean of the last block
+  int32_t goertzel_sum;
+  uint32_t goertzel_blocks;
+  float goertzel_freq[INA219_GOERTZEL_MAX_BINS];
+  int32_t goertzel_coeff[INA219_GOERTZEL_MAX_BINS];  // 2cos(w) in Q14
+  int32_t goertzel_s1[INA219_GOERTZEL_MAX_BINS];
+  int32_t goertzel_s2[INA219_GOERTZEL_MAX_BINS];
+  float goertzel_amplitude[INA219_GOERTZEL_MAX_BINS];
+};
+
+#endif
@@ -0,0 +1,161 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Group.cpp
+	@license  BSD (see license.txt)
+	
+	Near-simultaneous sampling of several INA219 on the same bus
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+#include "Adafruit_INA219_Group.h"
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates an empty group
+*/
+/**************************************************************************/
+Adafruit_INA219_Group::Adafruit_INA219_Group() {
+  group_count = 0;
+  group_trigger_us = 0;
+  group_skew_us = 0;
+  group_read_us = 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Adds a sensor, already begun and calibrated.  Returns its
+            index in the samples, or -1 if the group is full.  The
+            first trigger() switches it to triggered mode for good.
+*/
+/**************************************************************************/
+int8_t Adafruit_INA219_Group::add(Adafruit_INA219 *sensor) {
+  if (group_count >= INA219_GROUP_MAX_SENSORS)
+    return -1;
+  group_sensors[group_count] = sensor;
+  return group_count++;
+}
+
+uint8_t Adafruit_INA219_Group::getCount() {
+  return group_count;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Starts a conversion on every sensor, one config write each
+            with nothing in between.  Returns false if a write failed.
+
+    @note   The INA219 only answers the I2C general call with a reset
+            (06h), so there is no broadcast write of the config
+            register; the skew is the time of the writes after the
+            first, see getTriggerSkew_us().
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Group::trigger() {
+  bool ok = true;
+  uint32_t now = 0;
+
+  for (uint8_t i = 0; i < group_count; i++) {
+    ok &= group_sensors[i]->triggerConversion();
+    // the conversion starts at the end of the write
+    now = micros();
+    if (i == 0)
+      group_trigger_us = now;
+  }
+  group_skew_us = now - group_trigger_us;
+  return ok;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Waits for the slowest conversion of the last trigger() and
+            reads a full sample from each sensor into 'samples': first
+            the shunt and bus voltages of all of them back to back,
+            then current and power, which only takes bus transfers for
+            sensors not in software power mode.  Config changes from
+            auto-range or adaptive averaging are held back until every
+            sensor has been read, a config write would start a new
+            conversion.  Returns the number of sensors that had a new
+            conversion (INA219_BUSVOLTAGE_CNVR set in the sample flags).
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219_Group::read(ina219_sample_t *samples) {
+  uint32_t wait_us = getConversionTime_us() * (100 + INA219_GROUP_MARGIN_PCT) / 100;
+  uint32_t due = group_trigger_us + group_skew_us + wait_us;
+  uint8_t fresh = 0;
+
+  int32_t left_us = (int32_t)(due - micros());
+  if (left_us > 0) {
+    delay(left_us / 1000);
+    delayMicroseconds(left_us % 1000);
+  }
+
+  uint32_t start = micros();
+  for (uint8_t i = 0; i < group_count; i++)
+    group_sensors[i]->holdConfig(true);
+  for (uint8_t i = 0; i < group_count; i++)
+    group_sensors[i]->getSampleVoltages(&samples[i]);
+  for (uint8_t i = 0; i < group_count; i++) {
+    group_sensors[i]->getSampleCurrentPower(&samples[i]);
+    if (samples[i].flags & INA219_BUSVOLTAGE_CNVR)
+      fresh++;
+  }
+  for (uint8_t i = 0; i < group_count; i++)
+    group_sensors[i]->holdConfig(false);
+  group_read_us = micros() - start;
+  return fresh;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  trigger() then read()
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219_Group::acquire(ina219_sample_t *samples) {
+  trigger();
+  return read(samples);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the longest conversion time in us of the group
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Group::getConversionTime_us() {
+  uint32_t time_us = 0;
+
+  for (uint8_t i = 0; i < group_count; i++) {
+    uint32_t t = group_sensors[i]->getConversionTime_us();
+    if (t > time_us)
+      time_us = t;
+  }
+  return time_us;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the time in us between the first and the last
+            conversion start of the last trigger()
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Group::getTriggerSkew_us() {
+  return group_skew_us;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the time in us the last read() took on the bus,
+            which doesn't skew the samples
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Group::getReadTime_us() {
+  return group_read_us;
+}
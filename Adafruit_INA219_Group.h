@@ -0,0 +1,61 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Group.h
+	@license  BSD (see license.txt)
+	
+	Near-simultaneous sampling of several INA219 on the same bus
+
+	All the devices are put in triggered mode and their conversions
+	started by back to back config writes, so the samples are only
+	skewed by the length of those writes.  The results are held in
+	the chips until read, so reading them back one after the other
+	adds no skew.
+
+	The sensors stay in triggered mode after the group is used; call
+	setMode() on them to go back to continuous conversions.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_GROUP_H_
+#define _ADAFRUIT_INA219_GROUP_H_
+
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+#include "Adafruit_INA219.h"
+
+/*=========================================================================
+    GROUP ACQUISITION
+    -----------------------------------------------------------------------*/
+    #define INA219_GROUP_MAX_SENSORS               (8)
+    #define INA219_GROUP_MARGIN_PCT                (10)      // Conversion time tolerance of the chip clock
+/*=========================================================================*/
+
+class Adafruit_INA219_Group{
+ public:
+  Adafruit_INA219_Group(void);
+  int8_t add(Adafruit_INA219 *sensor);
+  uint8_t getCount(void);
+  bool trigger(void);
+  uint8_t read(ina219_sample_t *samples);
+  uint8_t acquire(ina219_sample_t *samples);
+  uint32_t getConversionTime_us(void);
+  uint32_t getTriggerSkew_us(void);
+  uint32_t getReadTime_us(void);
+
+ private:
+  Adafruit_INA219 *group_sensors[INA219_GROUP_MAX_SENSORS];
+  uint8_t group_count;
+  uint32_t group_trigger_us;                 // end of the first config write
+  uint32_t group_skew_us;
+  uint32_t group_read_us;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Tiny.cpp
+	@license  BSD (see license.txt)
+	
+	Minimal INA219 driver for ATtiny85-class parts
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+#include "Adafruit_INA219_Tiny.h"
+
+/**************************************************************************/
+/*! 
+    @brief  Writes a 16 bit register over I2C
+*/
+/**************************************************************************/
+void Adafruit_INA219_Tiny::wireWriteRegister(uint8_t reg, uint16_t value)
+{
+  Wire.beginTransmission(ina219_i2caddr);
+  #if ARDUINO >= 100
+    Wire.write(reg);                       // Register
+    Wire.write(value >> 8);                // Upper 8-bits
+    Wire.write(value & 0xFF);              // Lower 8-bits
+  #else
+    Wire.send(reg);                        // Register
+    Wire.send(value >> 8);                 // Upper 8-bits
+    Wire.send(value & 0xFF);               // Lower 8-bits
+  #endif
+  Wire.endTransmission();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads a 16 bit register over I2C
+*/
+/**************************************************************************/
+int16_t Adafruit_INA219_Tiny::wireReadRegister(uint8_t reg)
+{
+  Wire.beginTransmission(ina219_i2caddr);
+  #if ARDUINO >= 100
+    Wire.write(reg);                       // Register
+  #else
+    Wire.send(reg);                        // Register
+  #endif
+  Wire.endTransmission();
+
+  Wire.requestFrom(ina219_i2caddr, (uint8_t)2);
+  #if ARDUINO >= 100
+    uint16_t value = Wire.read() << 8;
+    return value | Wire.read();
+  #else
+    uint16_t value = Wire.receive() << 8;
+    return value | Wire.receive();
+  #endif
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates a new tiny INA219 class
+*/
+/**************************************************************************/
+Adafruit_INA219_Tiny::Adafruit_INA219_Tiny(uint8_t addr) {
+  ina219_i2caddr = addr;
+  ina219_calValue = 0;
+  ina219_currentLsb_uA = 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sets up the HW with a precomputed calibration value, current
+            LSB and config register (defaults to 32V and 2A)
+*/
+/**************************************************************************/
+void Adafruit_INA219_Tiny::begin(uint16_t cal, uint16_t currentLsb_uA, uint16_t config) {
+  ina219_calValue = cal;
+  ina219_currentLsb_uA = currentLsb_uA;
+  Wire.begin();
+  wireWriteRegister(INA219_REG_CALIBRATION, cal);
+  wireWriteRegister(INA219_REG_CONFIG, config);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the shunt voltage in uV (10uV per bit)
+*/
+/**************************************************************************/
+int32_t Adafruit_INA219_Tiny::getShuntVoltage_uV() {
+  return (int32_t)wireReadRegister(INA219_REG_SHUNTVOLTAGE) * 10;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the bus voltage in mV
+*/
+/**************************************************************************/
+uint16_t Adafruit_INA219_Tiny::getBusVoltage_mV() {
+  // Shift to the right 3 to drop CNVR and OVF and multiply by LSB
+  return ((uint16_t)wireReadRegister(INA219_REG_BUSVOLTAGE) >> 3) * 4;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the current in uA
+*/
+/**************************************************************************/
+int32_t Adafruit_INA219_Tiny::getCurrent_uA() {
+  // a sharp load can reset the chip and its cal register, see
+  // Adafruit_INA219::getCurrent_raw()
+  wireWriteRegister(INA219_REG_CALIBRATION, ina219_calValue);
+  return (int32_t)wireReadRegister(INA219_REG_CURRENT) * ina219_currentLsb_uA;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the power in uW, PowerLSB = 20 * CurrentLSB
+*/
+/**************************************************************************/
+int32_t Adafruit_INA219_Tiny::getPower_uW() {
+  return (int32_t)(uint16_t)wireReadRegister(INA219_REG_POWER) * 20 * ina219_currentLsb_uA;
+}
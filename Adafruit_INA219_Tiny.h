@@ -0,0 +1,56 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Tiny.h
+	@license  BSD (see license.txt)
+	
+	Minimal INA219 driver for ATtiny85-class parts (8KB flash, 512B RAM)
+
+	Integer math only, no float and no libm: the calibration value
+	and current LSB are given precomputed (see the calculations in
+	Adafruit_INA219.cpp) and readings come in uV, mV, uA and uW.
+	Only the calls used by the getcurrent example are provided.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_TINY_H_
+#define _ADAFRUIT_INA219_TINY_H_
+
+#include "Adafruit_INA219.h"
+
+/*=========================================================================
+    DEFAULT CALIBRATION (32V, 2A with a 0.1 ohm shunt)
+    -----------------------------------------------------------------------*/
+    #define INA219_TINY_CAL_32V_2A                 (4096)    // Cal register value
+    #define INA219_TINY_LSB_32V_2A_UA              (100)     // Current LSB in uA
+    #define INA219_TINY_CONFIG_32V_2A              (INA219_CONFIG_BVOLTAGERANGE_32V | \
+                                                    INA219_CONFIG_GAIN_8_320MV | \
+                                                    INA219_CONFIG_BADCRES_12BIT | \
+                                                    INA219_CONFIG_SADCRES_12BIT_1S_532US | \
+                                                    INA219_CONFIG_MODE_SANDBVOLT_CONTINUOUS)
+/*=========================================================================*/
+
+class Adafruit_INA219_Tiny{
+ public:
+  Adafruit_INA219_Tiny(uint8_t addr = INA219_ADDRESS);
+  void begin(uint16_t cal = INA219_TINY_CAL_32V_2A,
+             uint16_t currentLsb_uA = INA219_TINY_LSB_32V_2A_UA,
+             uint16_t config = INA219_TINY_CONFIG_32V_2A);
+  int32_t getShuntVoltage_uV(void);
+  uint16_t getBusVoltage_mV(void);
+  int32_t getCurrent_uA(void);
+  int32_t getPower_uW(void);
+
+ private:
+  uint8_t ina219_i2caddr;
+  uint16_t ina219_calValue;
+  uint16_t ina219_currentLsb_uA;
+
+  void wireWriteRegister(uint8_t reg, uint16_t value);
+  int16_t wireReadRegister(uint8_t reg);
+};
+
+#endif
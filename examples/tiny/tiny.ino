@@ -0,0 +1,22 @@
+// Minimal example for ATtiny85 boards (Trinket, Gemma), which have no
+// serial port: the LED lights up while the load draws more than 500mA.
+#include <Adafruit_INA219_Tiny.h>
+
+#define LED_PIN 1
+#define CURRENT_LIMIT_UA 500000
+
+Adafruit_INA219_Tiny ina219;
+
+void setup(void) 
+{
+  pinMode(LED_PIN, OUTPUT);
+  ina219.begin();
+}
+
+void loop(void) 
+{
+  int32_t current_uA = ina219.getCurrent_uA();
+
+  digitalWrite(LED_PIN, current_uA > CURRENT_LIMIT_UA ? HIGH : LOW);
+  delay(100);
+}
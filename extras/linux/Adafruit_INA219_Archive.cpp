@@ -0,0 +1,486 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Archive.cpp
+	@license  BSD (see license.txt)
+	
+	Block archive of compressed sensor records with a sparse time index
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Adafruit_INA219_Archive.h"
+
+#define BLOCK_BUFFER_BYTES  (sizeof(ina219_block_header_t) + \
+                             INA219_CODEC_HEADER_BYTES + \
+                             INA219_ARCHIVE_BLOCK_RECORDS * INA219_CODEC_MAX_RECORD_BYTES)
+
+/**************************************************************************/
+/*! 
+    @brief  Energy in J between two records, 0 across long gaps
+*/
+/**************************************************************************/
+static double segmentEnergy(uint64_t from_ns, int32_t fromPower, uint64_t to_ns,
+                            int32_t toPower, float currentLsb_mA) {
+  if (to_ns <= from_ns || to_ns - from_ns > INA219_ARCHIVE_MAX_GAP_NS)
+    return 0;
+  // power in current LSB x 1mV, i.e. currentLsb_mA uW
+  return ((double)fromPower + toPower) / 2 * currentLsb_mA * 1e-6 * (to_ns - from_ns) * 1e-9;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Adds a good record to the min/max/sum of a summary
+*/
+/**************************************************************************/
+static void foldRecord(ina219_summary_t *s, const ina219_record_t *r) {
+  if (s->good == 0) {
+    s->current_min = s->current_max = r->current;
+    s->bus_min = s->bus_max = r->bus;
+    s->power_min = s->power_max = r->power;
+  } else {
+    if (r->current < s->current_min) s->current_min = r->current;
+    if (r->current > s->current_max) s->current_max = r->current;
+    if (r->bus < s->bus_min) s->bus_min = r->bus;
+    if (r->bus > s->bus_max) s->bus_max = r->bus;
+    if (r->power < s->power_min) s->power_min = r->power;
+    if (r->power > s->power_max) s->power_max = r->power;
+  }
+  s->current_sum += r->current;
+  s->bus_sum += r->bus;
+  s->good++;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates an archive, see open()
+*/
+/**************************************************************************/
+Adafruit_INA219_Archive::Adafruit_INA219_Archive() {
+  arc_fd = -1;
+  arc_writable = false;
+  arc_end = 0;
+  arc_decoded = 0;
+  memset(arc_index, 0, sizeof(arc_index));
+  for (int i = 0; i < INA219_RING_MAX_SENSORS; i++) {
+    arc_open[i].buffer = NULL;
+    memset(&arc_open[i].summary, 0, sizeof(ina219_summary_t));
+    arc_open[i].cal = 0;
+    arc_open[i].hasLast = false;
+  }
+}
+
+Adafruit_INA219_Archive::~Adafruit_INA219_Archive() {
+  close();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Opens (or with 'writable', creates) the archive 'path' and
+            indexes its blocks from their headers.  A block cut short
+            by a crash ends the archive, and is cut off if writable.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Archive::open(const char *path, bool writable) {
+  close();
+  arc_fd = ::open(path, (writable ? O_RDWR | O_CREAT : O_RDONLY) | O_CLOEXEC, 0644);
+  if (arc_fd < 0)
+    return false;
+  arc_writable = writable;
+
+  struct stat st;
+  if (fstat(arc_fd, &st) < 0) {
+    close();
+    return false;
+  }
+
+  uint64_t offset = 0;
+  ina219_block_header_t header;
+  while (offset + sizeof(header) <= (uint64_t)st.st_size &&
+         pread(arc_fd, &header, sizeof(header), offset) == (ssize_t)sizeof(header) &&
+         header.magic == INA219_ARCHIVE_MAGIC &&
+         header.summary.sensor < INA219_RING_MAX_SENSORS &&
+         offset + sizeof(header) + header.bytes <= (uint64_t)st.st_size) {
+    if (!addToIndex(offset, &header.summary)) {
+      close();
+      return false;
+    }
+    offset += sizeof(header) + header.bytes;
+  }
+  arc_end = offset;
+  if (writable && arc_end < (uint64_t)st.st_size && ftruncate(arc_fd, arc_end) < 0) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Describes sensor 'index' for the blocks written from now on;
+            'cal', if known, makes current cost a bit per record
+*/
+/**************************************************************************/
+void Adafruit_INA219_Archive::setSensor(uint8_t index, uint8_t address, float currentLsb_mA,
+                                        uint16_t cal) {
+  if (index >= INA219_RING_MAX_SENSORS)
+    return;
+  arc_open[index].summary.address = address;
+  arc_open[index].summary.currentLsb_mA = currentLsb_mA;
+  arc_open[index].cal = cal;
+}
+
+bool Adafruit_INA219_Archive::addToIndex(uint64_t offset, const ina219_summary_t *summary) {
+  index *idx = &arc_index[summary->sensor];
+
+  if (idx->count == idx->allocated) {
+    uint32_t allocated = idx->allocated ? idx->allocated * 2 : 64;
+    ina219_block_t *blocks = (ina219_block_t *)realloc(idx->blocks,
+                                                       allocated * sizeof(ina219_block_t));
+    if (blocks == NULL)
+      return false;
+    idx->blocks = blocks;
+    idx->allocated = allocated;
+  }
+  idx->blocks[idx->count].offset = offset;
+  idx->blocks[idx->count].summary = *summary;
+  idx->count++;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Appends a record to the open block of its sensor, which is
+            written out once it has INA219_ARCHIVE_BLOCK_RECORDS records
+            or no room for the next one.  Records of a sensor must come
+            in time order.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Archive::append(const ina219_record_t *original) {
+  if (!arc_writable || original->sensor >= INA219_RING_MAX_SENSORS)
+    return false;
+
+  // summaries use the times as stored, rounded by the codec
+  ina219_record_t rounded = *original;
+  const ina219_record_t *record = &rounded;
+  rounded.time_ns = (original->time_ns + INA219_ARCHIVE_RESOLUTION_NS / 2) /
+                    INA219_ARCHIVE_RESOLUTION_NS * INA219_ARCHIVE_RESOLUTION_NS;
+
+  open_block *b = &arc_open[record->sensor];
+  ina219_summary_t *s = &b->summary;
+  if (b->buffer == NULL) {
+    b->buffer = (uint8_t *)malloc(BLOCK_BUFFER_BYTES);
+    if (b->buffer == NULL)
+      return false;
+  }
+  for (;;) {
+    if (s->count == 0) {
+      b->encoder.begin(b->buffer + sizeof(ina219_block_header_t),
+                       BLOCK_BUFFER_BYTES - sizeof(ina219_block_header_t),
+                       b->cal, INA219_ARCHIVE_RESOLUTION_NS);
+      s->first_ns = record->time_ns;
+      s->sensor = record->sensor;
+      s->address = record->address;
+    }
+    if (b->encoder.add(record))
+      break;
+    // the buffer filled up before the record count did: the record
+    // goes in a new block, and only fails on its own
+    if (s->count == 0 || !writeBlock(record->sensor))
+      return false;
+  }
+
+  s->last_ns = record->time_ns;
+  s->count++;
+  if (record->status == 0) {
+    double energy = 0;
+    if (b->hasLast)
+      energy = segmentEnergy(b->last_ns, b->lastPower, record->time_ns, record->power,
+                             s->currentLsb_mA);
+    if (s->good == 0)
+      s->energyIn_J = energy;
+    s->energy_J += energy;
+    foldRecord(s, record);
+    b->hasLast = true;
+    b->last_ns = record->time_ns;
+    b->lastPower = record->power;
+  }
+
+  if (s->count == INA219_ARCHIVE_BLOCK_RECORDS)
+    return writeBlock(record->sensor);
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Writes the open block of 'sensor' with its header in one
+            write, and indexes it
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Archive::writeBlock(uint8_t sensor) {
+  open_block *b = &arc_open[sensor];
+  ina219_block_header_t header;
+
+  header.magic = INA219_ARCHIVE_MAGIC;
+  header.bytes = b->encoder.finish();
+  header.summary = b->summary;
+  memcpy(b->buffer, &header, sizeof(header));
+
+  size_t size = sizeof(header) + header.bytes;
+  if (pwrite(arc_fd, b->buffer, size, arc_end) != (ssize_t)size ||
+      !addToIndex(arc_end, &header.summary))
+    return false;
+  arc_end += size;
+
+  // a new block keeps the sensor description
+  ina219_summary_t *s = &b->summary;
+  uint8_t address = s->address;
+  float currentLsb_mA = s->currentLsb_mA;
+  memset(s, 0, sizeof(*s));
+  s->address = address;
+  s->currentLsb_mA = currentLsb_mA;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Writes all open blocks, even partial, and syncs the file
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Archive::flush() {
+  bool ok = true;
+
+  if (!arc_writable)
+    return false;
+  for (int i = 0; i < INA219_RING_MAX_SENSORS; i++)
+    if (arc_open[i].summary.count != 0)
+      ok &= writeBlock(i);
+  return ok && fdatasync(arc_fd) == 0;
+}
+
+uint32_t Adafruit_INA219_Archive::getBlocks(uint8_t sensor) {
+  return (sensor < INA219_RING_MAX_SENSORS) ? arc_index[sensor].count : 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Points 'blocks' to the indexed blocks of 'sensor' holding
+            records in [from_ns, to_ns), in time order, and returns
+            their count.  Binary search, no file access.
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Archive::find(uint8_t sensor, uint64_t from_ns, uint64_t to_ns,
+                                       const ina219_block_t **blocks) {
+  if (sensor >= INA219_RING_MAX_SENSORS || to_ns <= from_ns)
+    return 0;
+
+  const index *idx = &arc_index[sensor];
+  uint32_t low = 0, high = idx->count;
+  // first block ending at or after from_ns
+  while (low < high) {
+    uint32_t mid = (low + high) / 2;
+    if (idx->blocks[mid].summary.last_ns < from_ns)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  uint32_t last = low;
+  while (last < idx->count && idx->blocks[last].summary.first_ns < to_ns)
+    last++;
+  *blocks = &idx->blocks[low];
+  return last - low;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads and decodes the records of a block into 'records',
+            which holds INA219_ARCHIVE_BLOCK_RECORDS
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Archive::decodeBlock(const ina219_block_t *block,
+                                              ina219_record_t *records) {
+  ina219_block_header_t header;
+  Adafruit_INA219_Decoder decoder;
+  uint32_t n = 0;
+
+  if (pread(arc_fd, &header, sizeof(header), block->offset) != (ssize_t)sizeof(header))
+    return 0;
+  uint8_t *payload = (uint8_t *)malloc(header.bytes);
+  if (payload == NULL)
+    return 0;
+  if (pread(arc_fd, payload, header.bytes, block->offset + sizeof(header)) == (ssize_t)header.bytes &&
+      decoder.begin(payload, header.bytes, header.summary.count)) {
+    while (n < INA219_ARCHIVE_BLOCK_RECORDS && decoder.next(&records[n]))
+      n++;
+  }
+  free(payload);
+  arc_decoded++;
+  return n;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Copies into 'records' (up to 'max') the records of 'sensor'
+            in [from_ns, to_ns), decoding only the blocks found in the
+            index.  Returns how many were copied.
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Archive::read(uint8_t sensor, uint64_t from_ns, uint64_t to_ns,
+                                       ina219_record_t *records, uint32_t max) {
+  const ina219_block_t *blocks;
+  uint32_t count = find(sensor, from_ns, to_ns, &blocks);
+  uint32_t n = 0;
+
+  ina219_record_t *decoded = (ina219_record_t *)malloc(INA219_ARCHIVE_BLOCK_RECORDS *
+                                                       sizeof(ina219_record_t));
+  if (decoded == NULL)
+    return 0;
+  for (uint32_t b = 0; b < count && n < max; b++) {
+    uint32_t got = decodeBlock(&blocks[b], decoded);
+    for (uint32_t i = 0; i < got && n < max; i++)
+      if (decoded[i].time_ns >= from_ns && decoded[i].time_ns < to_ns)
+        records[n++] = decoded[i];
+  }
+  free(decoded);
+  return n;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Summarizes the records of 'sensor' in [from_ns, to_ns):
+            blocks inside the range are merged from the index, only the
+            blocks across its ends are decoded.  Returns false if there
+            are no records.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Archive::aggregate(uint8_t sensor, uint64_t from_ns, uint64_t to_ns,
+                                        ina219_summary_t *summary) {
+  const ina219_block_t *blocks;
+  uint32_t count = find(sensor, from_ns, to_ns, &blocks);
+  ina219_record_t *decoded = NULL;
+
+  memset(summary, 0, sizeof(*summary));
+  for (uint32_t b = 0; b < count; b++) {
+    const ina219_summary_t *s = &blocks[b].summary;
+    if (s->first_ns >= from_ns && s->last_ns < to_ns) {
+      merge(summary, s);
+      continue;
+    }
+
+    if (decoded == NULL) {
+      decoded = (ina219_record_t *)malloc(INA219_ARCHIVE_BLOCK_RECORDS * sizeof(ina219_record_t));
+      if (decoded == NULL)
+        return false;
+    }
+    ina219_summary_t part;
+    memset(&part, 0, sizeof(part));
+    part.sensor = s->sensor;
+    part.address = s->address;
+    part.currentLsb_mA = s->currentLsb_mA;
+
+    uint32_t got = decodeBlock(&blocks[b], decoded);
+    const ina219_record_t *previous = NULL;
+    for (uint32_t i = 0; i < got; i++) {
+      const ina219_record_t *r = &decoded[i];
+      bool inside = r->time_ns >= from_ns && r->time_ns < to_ns;
+      if (inside) {
+        if (part.count == 0)
+          part.first_ns = r->time_ns;
+        part.last_ns = r->time_ns;
+        part.count++;
+      }
+      if (r->status != 0)
+        continue;
+      // the energy of a record is that of the segment ending at it
+      double energy = previous ? segmentEnergy(previous->time_ns, previous->power,
+                                               r->time_ns, r->power, s->currentLsb_mA)
+                               : s->energyIn_J;
+      previous = r;
+      if (inside) {
+        part.energy_J += energy;
+        foldRecord(&part, r);
+      }
+    }
+    merge(summary, &part);
+  }
+  free(decoded);
+  return summary->count != 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Adds summary 'from' into 'into', a zeroed 'into' is empty
+*/
+/**************************************************************************/
+void Adafruit_INA219_Archive::merge(ina219_summary_t *into, const ina219_summary_t *from) {
+  if (from->count == 0)
+    return;
+  if (into->count == 0) {
+    *into = *from;
+    return;
+  }
+  if (from->good != 0) {
+    if (into->good == 0) {
+      into->current_min = from->current_min;
+      into->current_max = from->current_max;
+      into->bus_min = from->bus_min;
+      into->bus_max = from->bus_max;
+      into->power_min = from->power_min;
+      into->power_max = from->power_max;
+    } else {
+      if (from->current_min < into->current_min) into->current_min = from->current_min;
+      if (from->current_max > into->current_max) into->current_max = from->current_max;
+      if (from->bus_min < into->bus_min) into->bus_min = from->bus_min;
+      if (from->bus_max > into->bus_max) into->bus_max = from->bus_max;
+      if (from->power_min < into->power_min) into->power_min = from->power_min;
+      if (from->power_max > into->power_max) into->power_max = from->power_max;
+    }
+  }
+  if (from->first_ns < into->first_ns)
+    into->first_ns = from->first_ns;
+  if (from->last_ns > into->last_ns)
+    into->last_ns = from->last_ns;
+  into->count += from->count;
+  into->good += from->good;
+  into->current_sum += from->current_sum;
+  into->bus_sum += from->bus_sum;
+  into->energy_J += from->energy_J;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the number of blocks decoded by read() and aggregate()
+            so far
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Archive::getDecodedBlocks() {
+  return arc_decoded;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Writes the open blocks (if writable) and closes the archive
+*/
+/**************************************************************************/
+void Adafruit_INA219_Archive::close() {
+  if (arc_fd >= 0 && arc_writable)
+    flush();
+  if (arc_fd >= 0)
+    ::close(arc_fd);
+  arc_fd = -1;
+  for (int i = 0; i < INA219_RING_MAX_SENSORS; i++) {
+    free(arc_index[i].blocks);
+    free(arc_open[i].buffer);
+    arc_index[i].blocks = NULL;
+    arc_index[i].count = arc_index[i].allocated = 0;
+    arc_open[i].buffer = NULL;
+    arc_open[i].hasLast = false;
+  }
+}
@@ -0,0 +1,121 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Archive.h
+	@license  BSD (see license.txt)
+	
+	Block archive of compressed sensor records with a sparse time
+	index, for range and aggregate queries
+
+	Records are grouped per sensor into blocks of up to
+	INA219_ARCHIVE_BLOCK_RECORDS, compressed with the record codec and
+	appended to the file behind a fixed-size header summarizing them:
+	first and last timestamps, min/max/sum of current, bus voltage and
+	power, and energy.  Opening the archive reads only these headers,
+	hopping from one to the next, to build the index in memory.  A
+	query binary-searches the blocks of a sensor by time; blocks that
+	lie entirely inside the range are answered from their summary, so
+	only the two blocks at its ends are read and decoded.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_ARCHIVE_H_
+#define _ADAFRUIT_INA219_ARCHIVE_H_
+
+#include "Adafruit_INA219_Ring.h"
+#include "Adafruit_INA219_Codec.h"
+
+/*=========================================================================
+    ARCHIVE LAYOUT
+    -----------------------------------------------------------------------*/
+    #define INA219_ARCHIVE_MAGIC                   (0x42414E49) // "INAB"
+    #define INA219_ARCHIVE_BLOCK_RECORDS           (4096)
+    #define INA219_ARCHIVE_RESOLUTION_NS           (1000)
+    // longer gaps between records add no energy
+    #define INA219_ARCHIVE_MAX_GAP_NS              (10000000000ULL)
+/*=========================================================================*/
+
+typedef struct {
+  uint64_t first_ns;        ///< Time of the first record
+  uint64_t last_ns;         ///< Time of the last record
+  uint32_t count;           ///< Records, good or not
+  uint32_t good;            ///< Records read without error, summarized below
+  uint8_t sensor;
+  uint8_t address;
+  uint16_t reserved;
+  float currentLsb_mA;
+  int16_t current_min;      ///< Raw current, in current LSBs
+  int16_t current_max;
+  int16_t bus_min;          ///< Bus voltage, mV
+  int16_t bus_max;
+  int32_t power_min;        ///< Power, current LSB x 1mV
+  int32_t power_max;
+  int64_t current_sum;
+  int64_t bus_sum;
+  double energy_J;          ///< Energy from the record before the block to the last one
+  double energyIn_J;        ///< Part of it before the first good record
+} ina219_summary_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t bytes;           ///< Compressed records following the header
+  ina219_summary_t summary;
+} ina219_block_header_t;
+
+typedef struct {
+  uint64_t offset;          ///< File offset of the block header
+  ina219_summary_t summary;
+} ina219_block_t;
+
+class Adafruit_INA219_Archive{
+ public:
+  Adafruit_INA219_Archive(void);
+  ~Adafruit_INA219_Archive(void);
+  bool open(const char *path, bool writable = false);
+  void setSensor(uint8_t index, uint8_t address, float currentLsb_mA, uint16_t cal = 0);
+  bool append(const ina219_record_t *record);
+  bool flush(void);
+  uint32_t getBlocks(uint8_t sensor);
+  uint32_t find(uint8_t sensor, uint64_t from_ns, uint64_t to_ns,
+                const ina219_block_t **blocks);
+  uint32_t read(uint8_t sensor, uint64_t from_ns, uint64_t to_ns,
+                ina219_record_t *records, uint32_t max);
+  bool aggregate(uint8_t sensor, uint64_t from_ns, uint64_t to_ns,
+                 ina219_summary_t *summary);
+  uint32_t getDecodedBlocks(void);
+  void close(void);
+
+  static void merge(ina219_summary_t *into, const ina219_summary_t *from);
+
+ private:
+  struct open_block {
+    uint8_t *buffer;
+    Adafruit_INA219_Encoder encoder;
+    ina219_summary_t summary;
+    uint16_t cal;
+    bool hasLast;           // last record of the sensor, for energy
+    uint64_t last_ns;
+    int32_t lastPower;
+  };
+  struct index {
+    ina219_block_t *blocks;
+    uint32_t count;
+    uint32_t allocated;
+  };
+
+  int arc_fd;
+  bool arc_writable;
+  uint64_t arc_end;
+  uint32_t arc_decoded;
+  index arc_index[INA219_RING_MAX_SENSORS];
+  open_block arc_open[INA219_RING_MAX_SENSORS];
+
+  bool addToIndex(uint64_t offset, const ina219_summary_t *summary);
+  bool writeBlock(uint8_t sensor);
+  uint32_t decodeBlock(const ina219_block_t *block, ina219_record_t *records);
+};
+
+#endif
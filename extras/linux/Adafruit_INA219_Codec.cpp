@@ -0,0 +1,430 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Codec.cpp
+	@license  BSD (see license.txt)
+	
+	Gorilla-style streaming compression of the records of one sensor
+
+	Stream: a header (version, sensor, address, 0, Cal, resolution_ns),
+	the first record in full, then per record:
+
+	  time     delta-of-delta, zigzag, class code on 7/9/12 bits or
+	           '1111' + the 64-bit time
+	  shunt    delta, class code on 2/5/9 bits or '1111' + the value
+	  bus      the same on deltas of 4mV, the bus LSB
+	  current  '0' if SHUNT * Cal / 4096, else '1' + as shunt
+	  power    '0' if current x bus (software power), '10' + the POWER
+	           register coded against current x bus / 20000, or '11'
+	           + the 32-bit value
+	  flags    '0' if unchanged, else '1' + flags and status
+
+	Class codes are '0' for zero, then '10', '110', '1110' + the
+	zigzag value minus the previous classes' range, '1111' escapes.
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <string.h>
+
+#include "Adafruit_INA219_Codec.h"
+
+static const uint8_t timeWidths[3] = { 7, 9, 12 };
+static const uint8_t valueWidths[3] = { 2, 5, 9 };
+static const uint8_t prefixes[3] = { 0x2, 0x6, 0xE };   // '10', '110', '1110'
+// largest zigzag values with a class code
+static const uint64_t timeCoded = (1ULL << 7) + (1ULL << 9) + (1ULL << 12);
+static const uint64_t valueCoded = (1ULL << 2) + (1ULL << 5) + (1ULL << 9);
+
+static inline uint64_t zigzag(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t u) {
+  return (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+}
+
+// the driver's and the chip's CURRENT = SHUNT * Cal / 4096
+static inline int32_t predictCurrent(int32_t shunt, uint16_t cal) {
+  return (int16_t)(shunt * (int32_t)cal / 4096);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates an encoder, see begin()
+*/
+/**************************************************************************/
+Adafruit_INA219_Encoder::Adafruit_INA219_Encoder() {
+  begin(NULL, 0);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Starts a stream in 'buffer'.  'cal' is the calibration of
+            the sensor (0 if unknown, current is then coded as a
+            delta), 'resolution_ns' the timestamp rounding.
+*/
+/**************************************************************************/
+void Adafruit_INA219_Encoder::begin(uint8_t *buffer, size_t size, uint16_t cal,
+                                    uint32_t resolution_ns) {
+  enc_buffer = buffer;
+  enc_size = size;
+  enc_pos = 0;
+  enc_acc = 0;
+  enc_accBits = 0;
+  enc_overflow = false;
+  enc_cal = cal;
+  enc_resolution_ns = resolution_ns ? resolution_ns : 1;
+  enc_count = 0;
+  memset(&enc_state, 0, sizeof(enc_state));
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Writes the low 'bits' bits of 'value', MSB first
+*/
+/**************************************************************************/
+void Adafruit_INA219_Encoder::put(uint32_t value, uint8_t bits) {
+  enc_acc = (enc_acc << bits) | (value & (uint32_t)((1ULL << bits) - 1));
+  enc_accBits += bits;
+  while (enc_accBits >= 8) {
+    enc_accBits -= 8;
+    if (enc_pos < enc_size)
+      enc_buffer[enc_pos] = (uint8_t)(enc_acc >> enc_accBits);
+    else
+      enc_overflow = true;
+    enc_pos++;
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Writes a class code for 'zz'; the caller writes the escape
+            payload if it returns with '1111' written (zz too large)
+*/
+/**************************************************************************/
+void Adafruit_INA219_Encoder::putCode(uint64_t zz, const uint8_t *widths) {
+  uint64_t base = 1;
+
+  if (zz == 0) {
+    put(0, 1);
+    return;
+  }
+  for (int c = 0; c < 3; c++) {
+    uint64_t range = 1ULL << widths[c];
+    if (zz < base + range) {
+      put(prefixes[c], c + 2);
+      put((uint32_t)(zz - base), widths[c]);
+      return;
+    }
+    base += range;
+  }
+  put(0xF, 4);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Codes 'value' as a delta from 'previous', or escapes
+*/
+/**************************************************************************/
+void Adafruit_INA219_Encoder::putValue(int32_t value, int32_t previous) {
+  uint64_t zz = zigzag((int64_t)value - previous);
+  putCode(zz, valueWidths);
+  if (zz > valueCoded)
+    put((uint32_t)value, 32);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Appends a record.  Returns false, leaving the stream as it
+            was, if it doesn't fit in the buffer.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Encoder::add(const ina219_record_t *record) {
+  size_t pos = enc_pos;
+  uint64_t acc = enc_acc;
+  uint8_t accBits = enc_accBits;
+  ina219_codec_state_t state = enc_state;
+  ina219_codec_state_t *s = &enc_state;
+
+  int64_t time = (int64_t)((record->time_ns + enc_resolution_ns / 2) / enc_resolution_ns);
+  int32_t bus = record->bus;
+  int32_t current = record->current;
+  int32_t power = record->power;
+  uint16_t flags = record->flags | record->status << 8;
+
+  if (enc_count == 0) {
+    put(INA219_CODEC_VERSION, 8);
+    put(record->sensor, 8);
+    put(record->address, 8);
+    put(0, 8);
+    put(enc_cal, 16);
+    put(enc_resolution_ns, 32);
+    put((uint32_t)((uint64_t)time >> 32), 32);
+    put((uint32_t)time, 32);
+    put((uint16_t)record->shunt, 16);
+    put((uint16_t)bus, 16);
+    put((uint16_t)current, 16);
+    put((uint32_t)power, 32);
+    put(flags, 16);
+  } else {
+    int64_t delta = time - s->time;
+    uint64_t zz = zigzag(delta - s->delta);
+    putCode(zz, timeWidths);
+    if (zz > timeCoded) {
+      put((uint32_t)((uint64_t)time >> 32), 32);
+      put((uint32_t)time, 32);
+    }
+    s->delta = delta;
+
+    putValue(record->shunt, s->shunt);
+
+    // bus voltages are multiples of the 4mV LSB, the escape holds the
+    // voltage itself
+    zz = zigzag((bus - s->bus) / 4);
+    if (((bus - s->bus) & 3) == 0) {
+      putCode(zz, valueWidths);
+      if (zz > valueCoded)
+        put((uint32_t)bus, 32);
+    } else {
+      put(0xF, 4);
+      put((uint32_t)bus, 32);
+    }
+
+    if (enc_cal != 0 && current == predictCurrent(record->shunt, enc_cal)) {
+      put(0, 1);
+    } else {
+      put(1, 1);
+      putValue(current, s->current);
+    }
+
+    int32_t product = current * bus;
+    if (power == product) {
+      put(0, 1);
+    } else if (power % 20000 == 0) {
+      put(2, 2);
+      putValue(power / 20000, product / 20000);
+    } else {
+      put(3, 2);
+      put((uint32_t)power, 32);
+    }
+
+    if (flags == s->flags) {
+      put(0, 1);
+    } else {
+      put(1, 1);
+      put(flags, 16);
+    }
+  }
+
+  if (enc_overflow) {
+    enc_pos = pos;
+    enc_acc = acc;
+    enc_accBits = accBits;
+    enc_state = state;
+    enc_overflow = false;
+    return false;
+  }
+  s->time = time;
+  s->shunt = record->shunt;
+  s->bus = bus;
+  s->current = current;
+  s->power = power;
+  s->flags = flags;
+  enc_count++;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Flushes the last bits and returns the stream length in
+            bytes; add() must not be called afterwards
+*/
+/**************************************************************************/
+size_t Adafruit_INA219_Encoder::finish() {
+  if (enc_accBits)
+    put(0, 8 - enc_accBits);
+  return enc_pos;
+}
+
+uint32_t Adafruit_INA219_Encoder::getCount() {
+  return enc_count;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the stream length so far in bits
+*/
+/**************************************************************************/
+size_t Adafruit_INA219_Encoder::getBits() {
+  return enc_pos * 8 + enc_accBits;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates a decoder, see begin()
+*/
+/**************************************************************************/
+Adafruit_INA219_Decoder::Adafruit_INA219_Decoder() {
+  dec_buffer = NULL;
+  dec_size = 0;
+  dec_count = dec_index = 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Starts decoding the 'count' records of a stream.  Returns
+            false if it isn't one.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Decoder::begin(const uint8_t *buffer, size_t size, uint32_t count) {
+  dec_buffer = buffer;
+  dec_size = size;
+  dec_pos = 0;
+  dec_acc = 0;
+  dec_accBits = 0;
+  dec_overrun = false;
+  dec_count = count;
+  dec_index = 0;
+  memset(&dec_state, 0, sizeof(dec_state));
+  if (count == 0)
+    return true;
+
+  if (size < INA219_CODEC_HEADER_BYTES || get(8) != INA219_CODEC_VERSION) {
+    dec_count = 0;
+    return false;
+  }
+  dec_sensor = get(8);
+  dec_address = get(8);
+  get(8);
+  dec_cal = get(16);
+  dec_resolution_ns = get(32);
+  return dec_resolution_ns != 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads 'bits' bits (up to 32), zeros past the end
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Decoder::get(uint8_t bits) {
+  while (dec_accBits < bits) {
+    uint8_t byte = 0;
+    if (dec_pos < dec_size)
+      byte = dec_buffer[dec_pos];
+    else
+      dec_overrun = true;
+    dec_pos++;
+    dec_acc = (dec_acc << 8) | byte;
+    dec_accBits += 8;
+  }
+  dec_accBits -= bits;
+  return (uint32_t)((dec_acc >> dec_accBits) & ((1ULL << bits) - 1));
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads a class prefix: 0 for '0' ... 3 for '1110', 4 for
+            the '1111' escape
+*/
+/**************************************************************************/
+int Adafruit_INA219_Decoder::getClass() {
+  int c = 0;
+  while (c < 4 && get(1))
+    c++;
+  return c;
+}
+
+static uint64_t getCoded(int c, const uint8_t *widths, uint32_t payload) {
+  uint64_t base = 1;
+  for (int i = 0; i < c - 1; i++)
+    base += 1ULL << widths[i];
+  return base + payload;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads a value coded by the encoder's putValue()
+*/
+/**************************************************************************/
+int32_t Adafruit_INA219_Decoder::getValue(int32_t previous) {
+  int c = getClass();
+  if (c == 0)
+    return previous;
+  if (c == 4)
+    return (int32_t)get(32);
+  return (int32_t)(previous + unzigzag(getCoded(c, valueWidths, get(valueWidths[c - 1]))));
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Decodes the next record; false after the last one or if the
+            stream is truncated
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Decoder::next(ina219_record_t *record) {
+  ina219_codec_state_t *s = &dec_state;
+
+  if (dec_index >= dec_count)
+    return false;
+
+  if (dec_index == 0) {
+    uint64_t high = get(32);
+    s->time = (int64_t)(high << 32 | get(32));
+    s->shunt = (int16_t)get(16);
+    s->bus = (int16_t)get(16);
+    s->current = (int16_t)get(16);
+    s->power = (int32_t)get(32);
+    s->flags = get(16);
+  } else {
+    int c = getClass();
+    if (c == 4) {
+      uint64_t high = get(32);
+      int64_t time = (int64_t)(high << 32 | get(32));
+      s->delta = time - s->time;
+    } else if (c != 0) {
+      s->delta += unzigzag(getCoded(c, timeWidths, get(timeWidths[c - 1])));
+    }
+    s->time += s->delta;
+
+    s->shunt = (int16_t)getValue(s->shunt);
+
+    c = getClass();
+    if (c == 4)
+      s->bus = (int16_t)get(32);
+    else if (c != 0)
+      s->bus += 4 * unzigzag(getCoded(c, valueWidths, get(valueWidths[c - 1])));
+
+    if (get(1) == 0)
+      s->current = predictCurrent(s->shunt, dec_cal);
+    else
+      s->current = (int16_t)getValue(s->current);
+
+    int32_t product = s->current * s->bus;
+    if (get(1) == 0)
+      s->power = product;
+    else if (get(1) == 0)
+      s->power = getValue(product / 20000) * 20000;
+    else
+      s->power = (int32_t)get(32);
+
+    if (get(1))
+      s->flags = get(16);
+  }
+  if (dec_overrun)
+    return false;
+
+  memset(record, 0, sizeof(*record));
+  record->time_ns = (uint64_t)s->time * dec_resolution_ns;
+  record->sensor = dec_sensor;
+  record->address = dec_address;
+  record->flags = s->flags & 0xFF;
+  record->status = s->flags >> 8;
+  record->shunt = s->shunt;
+  record->bus = s->bus;
+  record->current = s->current;
+  record->power = s->power;
+  dec_index++;
+  return true;
+}
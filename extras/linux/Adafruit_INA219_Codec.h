@@ -0,0 +1,105 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Codec.h
+	@license  BSD (see license.txt)
+	
+	Gorilla-style streaming compression of the records of one sensor
+
+	Timestamps are stored as delta-of-delta in 'resolution_ns' units,
+	the raw register values as deltas, both with short prefix codes
+	for the small values a steady rail gives ('0' for no change).  The
+	registers are integers, so zigzag deltas beat Gorilla's XOR of
+	floats.  Current and power are predicted from the other channels
+	the way the chip and the driver compute them: CURRENT = SHUNT *
+	Cal / 4096 with the calibration given to begin(), power = current
+	x bus in software power mode or a POWER register step near
+	current x bus / 20000 otherwise, so on most samples they cost a
+	bit or three.  Everything is lossless except timestamps, which are
+	rounded to the resolution.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_CODEC_H_
+#define _ADAFRUIT_INA219_CODEC_H_
+
+#include "Adafruit_INA219_Ring.h"
+
+/*=========================================================================
+    CODEC STREAM
+    -----------------------------------------------------------------------*/
+    #define INA219_CODEC_VERSION                   (1)
+    #define INA219_CODEC_HEADER_BYTES              (10)
+    // worst case size of one record, for sizing buffers: escapes on
+    // every field, 68 + 36 + 36 + 37 + 38 + 17 = 232 bits.  The first
+    // record takes INA219_CODEC_HEADER_BYTES + 20.
+    #define INA219_CODEC_MAX_RECORD_BYTES          (29)
+/*=========================================================================*/
+
+typedef struct {
+  int64_t time;             // in resolution units
+  int64_t delta;
+  int32_t shunt;
+  int32_t bus;
+  int32_t current;
+  int32_t power;
+  int32_t powerReg;         // power / 20000 of the last hardware power
+  uint16_t flags;           // flags | status << 8
+} ina219_codec_state_t;
+
+class Adafruit_INA219_Encoder{
+ public:
+  Adafruit_INA219_Encoder(void);
+  void begin(uint8_t *buffer, size_t size, uint16_t cal = 0, uint32_t resolution_ns = 1000);
+  bool add(const ina219_record_t *record);
+  size_t finish(void);
+  uint32_t getCount(void);
+  size_t getBits(void);
+
+ private:
+  uint8_t *enc_buffer;
+  size_t enc_size;
+  size_t enc_pos;
+  uint64_t enc_acc;
+  uint8_t enc_accBits;
+  bool enc_overflow;
+  uint16_t enc_cal;
+  uint32_t enc_resolution_ns;
+  uint32_t enc_count;
+  ina219_codec_state_t enc_state;
+
+  void put(uint32_t value, uint8_t bits);
+  void putCode(uint64_t zz, const uint8_t *widths);
+  void putValue(int32_t value, int32_t previous);
+};
+
+class Adafruit_INA219_Decoder{
+ public:
+  Adafruit_INA219_Decoder(void);
+  bool begin(const uint8_t *buffer, size_t size, uint32_t count);
+  bool next(ina219_record_t *record);
+
+ private:
+  const uint8_t *dec_buffer;
+  size_t dec_size;
+  size_t dec_pos;
+  uint64_t dec_acc;
+  uint8_t dec_accBits;
+  bool dec_overrun;
+  uint16_t dec_cal;
+  uint32_t dec_resolution_ns;
+  uint32_t dec_count;
+  uint32_t dec_index;
+  uint8_t dec_sensor;
+  uint8_t dec_address;
+  ina219_codec_state_t dec_state;
+
+  uint32_t get(uint8_t bits);
+  int getClass(void);
+  int32_t getValue(int32_t previous);
+};
+
+#endif
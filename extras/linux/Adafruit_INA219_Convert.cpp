@@ -0,0 +1,457 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Convert.cpp
+	@license  BSD (see license.txt)
+	
+	Batch conversion of raw INA219 values to physical units
+
+	Each kernel converts as many values as fit its vectors and returns
+	that count; the public functions finish the tail with the scalar
+	expressions, which are the driver's.  The SSE2 and AVX2 kernels
+	are compiled with target attributes, so the file builds for any
+	x86 and the AVX2 ones only run where the CPU has them; other
+	architectures get the scalar path.
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include "Adafruit_INA219_Convert.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CONVERT_X86
+#include <immintrin.h>
+#endif
+
+static uint8_t convertPath = INA219_CONVERT_AUTO;
+
+/*=========================================================================
+    SCALAR, THE DRIVER'S EXPRESSIONS
+    -----------------------------------------------------------------------*/
+static inline float shuntMv(int16_t value) {
+  return value * 0.01;
+}
+
+static inline int16_t busMv(uint16_t value) {
+  return (int16_t)((value >> 3) * 4);
+}
+
+static inline float busV(uint16_t value) {
+  int16_t mv = busMv(value);
+  return mv * 0.001;
+}
+
+static inline float scaled(int16_t value, float lsb) {
+  float valueDec = value;
+  valueDec *= lsb;
+  return valueDec;
+}
+
+static inline float samplePower(int32_t power, float currentLsb_mA) {
+  return power * currentLsb_mA / 1000;
+}
+/*=========================================================================*/
+
+#ifdef CONVERT_X86
+/*=========================================================================
+    SSE2
+    -----------------------------------------------------------------------*/
+#define SSE2 __attribute__((target("sse2")))
+
+// low 32 bits of 32 x 32 products, SSE2 has no pmulld
+static inline SSE2 __m128i mullo32_sse2(__m128i a, __m128i b) {
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline SSE2 __m128i lo16to32_sse2(__m128i v) {
+  return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+static inline SSE2 __m128i hi16to32_sse2(__m128i v) {
+  return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+}
+
+// 4 int32 x a double constant, narrowed to 4 floats
+static inline SSE2 __m128 scaleDouble_sse2(__m128i v, __m128d k) {
+  __m128 lo = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtepi32_pd(v), k));
+  __m128 hi = _mm_cvtpd_ps(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(v, 8)), k));
+  return _mm_movelh_ps(lo, hi);
+}
+
+// the driver's bus decoding on 8 register values: (v >> 3) * 4
+static inline SSE2 __m128i busMv_sse2(__m128i v) {
+  return _mm_srli_epi16(_mm_andnot_si128(_mm_set1_epi16(7), v), 1);
+}
+
+static SSE2 size_t shuntVoltage_mV_sse2(const int16_t *raw, float *out, size_t n) {
+  const __m128d k = _mm_set1_pd(0.01);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(raw + i));
+    _mm_storeu_ps(out + i, scaleDouble_sse2(lo16to32_sse2(v), k));
+    _mm_storeu_ps(out + i + 4, scaleDouble_sse2(hi16to32_sse2(v), k));
+  }
+  return i;
+}
+
+static SSE2 size_t busVoltage_V_sse2(const uint16_t *reg, float *out, size_t n) {
+  const __m128d k = _mm_set1_pd(0.001);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = busMv_sse2(_mm_loadu_si128((const __m128i *)(reg + i)));
+    _mm_storeu_ps(out + i, scaleDouble_sse2(_mm_unpacklo_epi16(v, zero), k));
+    _mm_storeu_ps(out + i + 4, scaleDouble_sse2(_mm_unpackhi_epi16(v, zero), k));
+  }
+  return i;
+}
+
+static SSE2 size_t scaled_sse2(const int16_t *raw, float lsb, float *out, size_t n) {
+  const __m128 k = _mm_set1_ps(lsb);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(raw + i));
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo16to32_sse2(v)), k));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi16to32_sse2(v)), k));
+  }
+  return i;
+}
+
+static SSE2 size_t samplePower_mW_sse2(const int32_t *power, float lsb, float *out, size_t n) {
+  const __m128 k = _mm_set1_ps(lsb);
+  const __m128 thousand = _mm_set1_ps(1000);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(power + i)));
+    _mm_storeu_ps(out + i, _mm_div_ps(_mm_mul_ps(v, k), thousand));
+  }
+  return i;
+}
+
+static SSE2 size_t shuntVoltage_uV_sse2(const int16_t *raw, int32_t *out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(raw + i));
+    __m128i lo = lo16to32_sse2(v), hi = hi16to32_sse2(v);
+    // x * 10 = x * 8 + x * 2
+    lo = _mm_add_epi32(_mm_slli_epi32(lo, 3), _mm_slli_epi32(lo, 1));
+    hi = _mm_add_epi32(_mm_slli_epi32(hi, 3), _mm_slli_epi32(hi, 1));
+    _mm_storeu_si128((__m128i *)(out + i), lo);
+    _mm_storeu_si128((__m128i *)(out + i + 4), hi);
+  }
+  return i;
+}
+
+static SSE2 size_t busVoltage_mV_sse2(const uint16_t *reg, int32_t *out, size_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = busMv_sse2(_mm_loadu_si128((const __m128i *)(reg + i)));
+    _mm_storeu_si128((__m128i *)(out + i), _mm_unpacklo_epi16(v, zero));
+    _mm_storeu_si128((__m128i *)(out + i + 4), _mm_unpackhi_epi16(v, zero));
+  }
+  return i;
+}
+
+static SSE2 size_t current_uA_sse2(const int16_t *raw, uint16_t lsb, int32_t *out, size_t n) {
+  const __m128i k = _mm_set1_epi32(lsb);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(raw + i));
+    _mm_storeu_si128((__m128i *)(out + i), mullo32_sse2(lo16to32_sse2(v), k));
+    _mm_storeu_si128((__m128i *)(out + i + 4), mullo32_sse2(hi16to32_sse2(v), k));
+  }
+  return i;
+}
+
+static SSE2 size_t power_uW_sse2(const uint16_t *reg, uint16_t lsb, int32_t *out, size_t n) {
+  const __m128i k = _mm_set1_epi32(20 * (uint32_t)lsb);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(reg + i));
+    _mm_storeu_si128((__m128i *)(out + i), mullo32_sse2(_mm_unpacklo_epi16(v, zero), k));
+    _mm_storeu_si128((__m128i *)(out + i + 4), mullo32_sse2(_mm_unpackhi_epi16(v, zero), k));
+  }
+  return i;
+}
+/*=========================================================================*/
+
+/*=========================================================================
+    AVX2
+    -----------------------------------------------------------------------*/
+#define AVX2 __attribute__((target("avx2")))
+
+// 4 int32 x a double constant, narrowed to 4 floats
+static inline AVX2 __m128 scaleDouble_avx2(__m128i v, __m256d k) {
+  return _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_cvtepi32_pd(v), k));
+}
+
+static AVX2 size_t shuntVoltage_mV_avx2(const int16_t *raw, float *out, size_t n) {
+  const __m256d k = _mm256_set1_pd(0.01);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(raw + i)));
+    _mm_storeu_ps(out + i, scaleDouble_avx2(_mm256_castsi256_si128(v), k));
+    _mm_storeu_ps(out + i + 4, scaleDouble_avx2(_mm256_extracti128_si256(v, 1), k));
+  }
+  return i;
+}
+
+static AVX2 size_t busVoltage_V_avx2(const uint16_t *reg, float *out, size_t n) {
+  const __m256d k = _mm256_set1_pd(0.001);
+  const __m256i mask = _mm256_set1_epi32(~7);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(reg + i)));
+    v = _mm256_srli_epi32(_mm256_and_si256(v, mask), 1);
+    _mm_storeu_ps(out + i, scaleDouble_avx2(_mm256_castsi256_si128(v), k));
+    _mm_storeu_ps(out + i + 4, scaleDouble_avx2(_mm256_extracti128_si256(v, 1), k));
+  }
+  return i;
+}
+
+static AVX2 size_t scaled_avx2(const int16_t *raw, float lsb, float *out, size_t n) {
+  const __m256 k = _mm256_set1_ps(lsb);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(raw + i)));
+    _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), k));
+  }
+  return i;
+}
+
+static AVX2 size_t samplePower_mW_avx2(const int32_t *power, float lsb, float *out, size_t n) {
+  const __m256 k = _mm256_set1_ps(lsb);
+  const __m256 thousand = _mm256_set1_ps(1000);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(power + i)));
+    _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_mul_ps(v, k), thousand));
+  }
+  return i;
+}
+
+static AVX2 size_t shuntVoltage_uV_avx2(const int16_t *raw, int32_t *out, size_t n) {
+  const __m256i ten = _mm256_set1_epi32(10);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(raw + i)));
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_mullo_epi32(v, ten));
+  }
+  return i;
+}
+
+static AVX2 size_t busVoltage_mV_avx2(const uint16_t *reg, int32_t *out, size_t n) {
+  const __m256i mask = _mm256_set1_epi32(~7);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(reg + i)));
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_srli_epi32(_mm256_and_si256(v, mask), 1));
+  }
+  return i;
+}
+
+static AVX2 size_t current_uA_avx2(const int16_t *raw, uint16_t lsb, int32_t *out, size_t n) {
+  const __m256i k = _mm256_set1_epi32(lsb);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(raw + i)));
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_mullo_epi32(v, k));
+  }
+  return i;
+}
+
+static AVX2 size_t power_uW_avx2(const uint16_t *reg, uint16_t lsb, int32_t *out, size_t n) {
+  const __m256i k = _mm256_set1_epi32(20 * (uint32_t)lsb);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(reg + i)));
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_mullo_epi32(v, k));
+  }
+  return i;
+}
+/*=========================================================================*/
+
+// runs the kernel of the current path, leaving 'i' at the first value left
+#define DISPATCH(i, kernel, ...)                                              \
+  do {                                                                        \
+    uint8_t p = getPath();                                                    \
+    if (p == INA219_CONVERT_AVX2)                                             \
+      i = kernel##_avx2(__VA_ARGS__);                                         \
+    else if (p == INA219_CONVERT_SSE2)                                        \
+      i = kernel##_sse2(__VA_ARGS__);                                         \
+  } while (0)
+#else
+#define DISPATCH(i, kernel, ...)  do { } while (0)
+#endif
+
+/**************************************************************************/
+/*! 
+    @brief  Tells if the CPU can run a path
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Convert::hasPath(uint8_t path) {
+  switch (path) {
+    case INA219_CONVERT_SCALAR:
+      return true;
+#ifdef CONVERT_X86
+    case INA219_CONVERT_SSE2:
+      return __builtin_cpu_supports("sse2");
+    case INA219_CONVERT_AVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Forces a path, or with INA219_CONVERT_AUTO the best the CPU
+            has.  Returns the path now used.
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219_Convert::setPath(uint8_t path) {
+  if (path == INA219_CONVERT_AUTO || !hasPath(path)) {
+    path = INA219_CONVERT_SCALAR;
+    if (hasPath(INA219_CONVERT_SSE2))
+      path = INA219_CONVERT_SSE2;
+    if (hasPath(INA219_CONVERT_AVX2))
+      path = INA219_CONVERT_AVX2;
+  }
+  convertPath = path;
+  return path;
+}
+
+uint8_t Adafruit_INA219_Convert::getPath() {
+  if (convertPath == INA219_CONVERT_AUTO)
+    return setPath(INA219_CONVERT_AUTO);
+  return convertPath;
+}
+
+const char *Adafruit_INA219_Convert::getPathName(uint8_t path) {
+  static const char *names[] = { "auto", "scalar", "sse2", "avx2" };
+  return (path <= INA219_CONVERT_AVX2) ? names[path] : "?";
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Shunt voltages in mV, as getShuntVoltage_mV()
+*/
+/**************************************************************************/
+void Adafruit_INA219_Convert::shuntVoltage_mV(const int16_t *raw, float *out, size_t n) {
+  size_t i = 0;
+  DISPATCH(i, shuntVoltage_mV, raw, out, n);
+  for (; i < n; i++)
+    out[i] = shuntMv(raw[i]);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Bus voltages in V from BUS register values, as
+            getBusVoltage_V()
+*/
+/**************************************************************************/
+void Adafruit_INA219_Convert::busVoltage_V(const uint16_t *reg, float *out, size_t n) {
+  size_t i = 0;
+  DISPATCH(i, busVoltage_V, reg, out, n);
+  for (; i < n; i++)
+    out[i] = busV(reg[i]);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Currents in mA, as getCurrent_mA()
+*/
+/**************************************************************************/
+void Adafruit_INA219_Convert::current_mA(const int16_t *raw, float currentLsb_mA,
+                                         float *out, size_t n) {
+  size_t i = 0;
+  DISPATCH(i, scaled, raw, currentLsb_mA, out, n);
+  for (; i < n; i++)
+    out[i] = scaled(raw[i], currentLsb_mA);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Powers in mW from POWER register values, as getPower_mW()
+            in hardware power mode
+*/
+/**************************************************************************/
+void Adafruit_INA219_Convert::power_mW(const int16_t *raw, float powerLsb_mW,
+                                       float *out, size_t n) {
+  size_t i = 0;
+  DISPATCH(i, scaled, raw, powerLsb_mW, out, n);
+  for (; i < n; i++)
+    out[i] = scaled(raw[i], powerLsb_mW);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Powers in mW from sample powers (current LSB x 1mV), as
+            getPower_mW(sample)
+*/
+/**************************************************************************/
+void Adafruit_INA219_Convert::samplePower_mW(const int32_t *power, float currentLsb_mA,
+                                             float *out, size_t n) {
+  size_t i = 0;
+  DISPATCH(i, samplePower_mW, power, currentLsb_mA, out, n);
+  for (; i < n; i++)
+    out[i] = samplePower(power[i], currentLsb_mA);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Shunt voltages in uV
+*/
+/**************************************************************************/
+void Adafruit_INA219_Convert::shuntVoltage_uV(const int16_t *raw, int32_t *out, size_t n) {
+  size_t i = 0;
+  DISPATCH(i, shuntVoltage_uV, raw, out, n);
+  for (; i < n; i++)
+    out[i] = (int32_t)raw[i] * 10;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Bus voltages in mV from BUS register values
+*/
+/**************************************************************************/
+void Adafruit_INA219_Convert::busVoltage_mV(const uint16_t *reg, int32_t *out, size_t n) {
+  size_t i = 0;
+  DISPATCH(i, busVoltage_mV, reg, out, n);
+  for (; i < n; i++)
+    out[i] = busMv(reg[i]);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Currents in uA for a current LSB in uA
+*/
+/**************************************************************************/
+void Adafruit_INA219_Convert::current_uA(const int16_t *raw, uint16_t currentLsb_uA,
+                                         int32_t *out, size_t n) {
+  size_t i = 0;
+  DISPATCH(i, current_uA, raw, currentLsb_uA, out, n);
+  for (; i < n; i++)
+    out[i] = (int32_t)raw[i] * currentLsb_uA;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Powers in uW from POWER register values, PowerLSB = 20 *
+            CurrentLSB; wraps like 32-bit math past 2^31 uW
+*/
+/**************************************************************************/
+void Adafruit_INA219_Convert::power_uW(const uint16_t *reg, uint16_t currentLsb_uA,
+                                       int32_t *out, size_t n) {
+  size_t i = 0;
+  DISPATCH(i, power_uW, reg, currentLsb_uA, out, n);
+  for (; i < n; i++)
+    out[i] = (int32_t)((uint32_t)reg[i] * 20 * currentLsb_uA);
+}
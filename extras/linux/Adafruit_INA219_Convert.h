@@ -0,0 +1,62 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Convert.h
+	@license  BSD (see license.txt)
+	
+	Batch conversion of raw INA219 values to physical units, with
+	SSE2 and AVX2 kernels and a scalar path
+
+	The float kernels compute exactly what the driver computes for one
+	value, operation for operation: shunt and bus voltages through a
+	double product narrowed to float (value * 0.01, value * 0.001),
+	current and power as float products, so every path gives the same
+	bits as Adafruit_INA219::getShuntVoltage_mV(), getBusVoltage_V(),
+	getCurrent_mA(), getPower_mW() and their sample variants.  Bus
+	kernels take BUS register values and do the driver's >> 3, * 4.
+	The fixed-point kernels follow Adafruit_INA219_Tiny (uV, mV, uA,
+	uW).  The path is chosen from the CPU at first use; setPath()
+	forces one.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_CONVERT_H_
+#define _ADAFRUIT_INA219_CONVERT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*=========================================================================
+    CONVERSION PATHS
+    -----------------------------------------------------------------------*/
+    #define INA219_CONVERT_AUTO                    (0)
+    #define INA219_CONVERT_SCALAR                  (1)
+    #define INA219_CONVERT_SSE2                    (2)
+    #define INA219_CONVERT_AVX2                    (3)
+/*=========================================================================*/
+
+class Adafruit_INA219_Convert{
+ public:
+  static uint8_t setPath(uint8_t path);
+  static uint8_t getPath(void);
+  static bool hasPath(uint8_t path);
+  static const char *getPathName(uint8_t path);
+
+  // float, bit-identical to the driver
+  static void shuntVoltage_mV(const int16_t *raw, float *out, size_t n);
+  static void busVoltage_V(const uint16_t *reg, float *out, size_t n);
+  static void current_mA(const int16_t *raw, float currentLsb_mA, float *out, size_t n);
+  static void power_mW(const int16_t *raw, float powerLsb_mW, float *out, size_t n);
+  static void samplePower_mW(const int32_t *power, float currentLsb_mA, float *out, size_t n);
+
+  // fixed point, as Adafruit_INA219_Tiny
+  static void shuntVoltage_uV(const int16_t *raw, int32_t *out, size_t n);
+  static void busVoltage_mV(const uint16_t *reg, int32_t *out, size_t n);
+  static void current_uA(const int16_t *raw, uint16_t currentLsb_uA, int32_t *out, size_t n);
+  static void power_uW(const uint16_t *reg, uint16_t currentLsb_uA, int32_t *out, size_t n);
+};
+
+#endif
@@ -0,0 +1,395 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Log.cpp
+	@license  BSD (see license.txt)
+	
+	Crash-safe circular sample log in a memory-mapped file
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Adafruit_INA219_Log.h"
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates a log, see open()
+*/
+/**************************************************************************/
+Adafruit_INA219_Log::Adafruit_INA219_Log() {
+  log_header = NULL;
+  log_slots = NULL;
+  log_size = 0;
+  log_head = log_oldest = log_synced = log_recovered = 0;
+  log_syncPeriod_ms = 0;
+  log_syncing = false;
+  pthread_mutex_init(&log_syncLock, NULL);
+  pthread_cond_init(&log_syncStop, NULL);
+}
+
+Adafruit_INA219_Log::~Adafruit_INA219_Log() {
+  close();
+  pthread_cond_destroy(&log_syncStop);
+  pthread_mutex_destroy(&log_syncLock);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns true if the file 'fd' is empty or its header is all
+            zeros, as left by a creation interrupted before the magic
+            number was written: only then may open() initialise it
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Log::unwritten(int fd, const struct stat *st) {
+  uint8_t header[INA219_LOG_HEADER_SIZE];
+
+  if (st->st_size == 0)
+    return true;
+  if (st->st_size < INA219_LOG_HEADER_SIZE ||
+      pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header))
+    return false;
+  for (size_t i = 0; i < sizeof(header); i++) {
+    if (header[i] != 0)
+      return false;
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Opens the log file 'path' and recovers its records, or
+            creates it with 'slots' slots (rounded up to a power of 2)
+            if it doesn't exist, is empty or its creation was cut short
+            (header still zero).  An existing log keeps its own size.
+            Returns false if the file can't be created, allocated or
+            mapped, and with errno EINVAL if it holds anything else, a
+            truncated log included, which is left untouched.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Log::open(const char *path, uint32_t slots, bool readOnly) {
+  uint32_t n = 1;
+  while (n < slots)
+    n <<= 1;
+
+  close();
+  int fd = ::open(path, (readOnly ? O_RDONLY : O_RDWR | O_CREAT) | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  ina219_log_header_t existing;
+  bool valid = fstat(fd, &st) == 0 &&
+               pread(fd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing) &&
+               existing.magic == INA219_LOG_MAGIC &&
+               existing.version == INA219_LOG_VERSION &&
+               existing.slotSize == sizeof(ina219_log_slot_t) &&
+               existing.slots != 0 && (existing.slots & (existing.slots - 1)) == 0 &&
+               (size_t)st.st_size >= INA219_LOG_HEADER_SIZE +
+                                     (size_t)existing.slots * sizeof(ina219_log_slot_t);
+  if (valid)
+    n = existing.slots;
+  else if (readOnly || !unwritten(fd, &st)) {
+    ::close(fd);
+    errno = EINVAL;
+    return false;
+  }
+
+  log_size = INA219_LOG_HEADER_SIZE + (size_t)n * sizeof(ina219_log_slot_t);
+  if (!valid) {
+    // allocate every block now, so a full disk shows here and not as
+    // a SIGBUS in append(); zeroed slots have seq 0, an empty log
+    if (ftruncate(fd, 0) < 0 || (errno = posix_fallocate(fd, 0, log_size)) != 0) {
+      ::close(fd);
+      return false;
+    }
+  }
+
+  void *map = mmap(NULL, log_size, readOnly ? PROT_READ : PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+    return false;
+  log_header = (ina219_log_header_t *)map;
+  log_slots = (ina219_log_slot_t *)((uint8_t *)map + INA219_LOG_HEADER_SIZE);
+
+  if (!valid) {
+    log_header->version = INA219_LOG_VERSION;
+    log_header->slots = n;
+    log_header->slotSize = sizeof(ina219_log_slot_t);
+    log_header->commit = 0;
+    log_header->magic = INA219_LOG_MAGIC;
+    msync(log_header, INA219_LOG_HEADER_SIZE, MS_SYNC);
+  }
+  recover(readOnly);
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Finds the valid records: from the commit index, forward
+            while each next slot holds the next sequence number, then
+            back the same way.  A slot only counts if its seq belongs
+            to it, so a slot lost or half-written by a crash ends the
+            run, and records past such a gap (never committed) are
+            dropped.  If the commit index was overwritten since, the
+            newest record found by a scan of all slots is used.
+            Unless read-only, slots numbered past the recovered head
+            are then cleared: once appends reach them they would look
+            like the next records and be recovered after a crash.
+*/
+/**************************************************************************/
+void Adafruit_INA219_Log::recover(bool readOnly) {
+  uint32_t mask = log_header->slots - 1;
+  uint64_t newest = log_header->commit ? log_header->commit : 1;
+
+  if (log_slots[(newest - 1) & mask].seq == newest) {
+    while (log_slots[newest & mask].seq == newest + 1)
+      newest++;
+  } else {
+    newest = 0;
+    for (uint32_t i = 0; i <= mask; i++) {
+      uint64_t seq = log_slots[i].seq;
+      if (seq != 0 && ((seq - 1) & mask) == i && seq > newest)
+        newest = seq;
+    }
+  }
+
+  uint64_t oldest = newest;
+  while (oldest > 1 && newest - oldest + 1 < log_header->slots &&
+         log_slots[(oldest - 2) & mask].seq == oldest - 1)
+    oldest--;
+
+  log_head = newest;
+  log_oldest = newest ? oldest : 0;
+  log_synced = (log_header->commit < newest) ? log_header->commit : newest;
+  log_recovered = newest ? newest - oldest + 1 : 0;
+
+  if (readOnly)
+    return;
+  bool cleared = false;
+  for (uint32_t i = 0; i <= mask; i++) {
+    if (log_slots[i].seq > newest) {
+      log_slots[i].seq = 0;
+      cleared = true;
+    }
+  }
+  if (cleared)
+    msync(log_slots, (size_t)log_header->slots * sizeof(ina219_log_slot_t), MS_SYNC);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Records the sensors logged, with setSensor() for each, so
+            the file can be read alone
+*/
+/**************************************************************************/
+void Adafruit_INA219_Log::setSensors(uint32_t sensors) {
+  if (log_header != NULL && sensors <= INA219_RING_MAX_SENSORS)
+    log_header->sensors = sensors;
+}
+
+void Adafruit_INA219_Log::setSensor(uint8_t index, uint8_t address, float currentLsb_mA) {
+  if (log_header == NULL || index >= INA219_RING_MAX_SENSORS)
+    return;
+  log_header->sensor[index].address = address;
+  log_header->sensor[index].currentLsb_mA = currentLsb_mA;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Appends a record and returns its sequence number: memory
+            stores only, durable at the next sync()
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA219_Log::append(const ina219_record_t *record) {
+  uint64_t seq = log_head + 1;
+  ina219_log_slot_t *slot = &log_slots[(seq - 1) & (log_header->slots - 1)];
+
+  // invalidate the slot first so a crash in between can't leave the
+  // old seq on a new record
+  __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  slot->record = *record;
+  __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+  __atomic_store_n(&log_head, seq, __ATOMIC_RELEASE);
+  if (log_oldest == 0)
+    log_oldest = seq;
+  else if (seq - log_oldest >= log_header->slots)
+    log_oldest = seq - log_header->slots + 1;
+  return seq;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  msyncs the pages holding slots 'first' to 'last'
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Log::syncSlots(uint64_t first, uint64_t last) {
+  static const uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t from = (uintptr_t)&log_slots[(first - 1) & (log_header->slots - 1)];
+  uintptr_t to = (uintptr_t)&log_slots[(last - 1) & (log_header->slots - 1)] +
+                 sizeof(ina219_log_slot_t);
+
+  from &= ~(page - 1);
+  return msync((void *)from, to - from, MS_SYNC) == 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Makes the records appended so far durable, then advances
+            the commit index.  Only one thread may call it.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Log::sync() {
+  uint64_t head = __atomic_load_n(&log_head, __ATOMIC_ACQUIRE);
+  uint64_t first = log_synced + 1;
+  uint32_t slots = log_header->slots;
+  bool ok = true;
+
+  if (head < first)
+    return true;
+  if (head - first >= slots)
+    first = head - slots + 1;
+
+  // the range wraps at most once
+  uint64_t wrap = first + (slots - ((first - 1) & (slots - 1)));
+  if (wrap <= head) {
+    ok = syncSlots(first, wrap - 1) && syncSlots(wrap, head);
+  } else {
+    ok = syncSlots(first, head);
+  }
+  if (!ok)
+    return false;
+
+  log_synced = head;
+  log_header->commit = head;
+  return msync(log_header, INA219_LOG_HEADER_SIZE, MS_SYNC) == 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sync thread, every log_syncPeriod_ms until close()
+*/
+/**************************************************************************/
+void *Adafruit_INA219_Log::syncLoop(void *self) {
+  Adafruit_INA219_Log *log = (Adafruit_INA219_Log *)self;
+  struct timespec next;
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  pthread_mutex_lock(&log->log_syncLock);
+  while (log->log_syncing) {
+    next.tv_nsec += (long)(log->log_syncPeriod_ms % 1000) * 1000000;
+    next.tv_sec += log->log_syncPeriod_ms / 1000 + next.tv_nsec / 1000000000;
+    next.tv_nsec %= 1000000000;
+    if (pthread_cond_timedwait(&log->log_syncStop, &log->log_syncLock, &next) == ETIMEDOUT) {
+      pthread_mutex_unlock(&log->log_syncLock);
+      log->sync();
+      pthread_mutex_lock(&log->log_syncLock);
+    }
+  }
+  pthread_mutex_unlock(&log->log_syncLock);
+  log->sync();
+  return NULL;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Starts a thread calling sync() every 'period_ms', so the
+            writer never waits for the disk
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Log::startSync(uint32_t period_ms) {
+  if (log_header == NULL || log_syncing || period_ms == 0)
+    return false;
+
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_destroy(&log_syncStop);
+  pthread_cond_init(&log_syncStop, &attr);
+  pthread_condattr_destroy(&attr);
+
+  log_syncPeriod_ms = period_ms;
+  log_syncing = true;
+  if (pthread_create(&log_syncThread, NULL, syncLoop, this) != 0) {
+    log_syncing = false;
+    return false;
+  }
+  return true;
+}
+
+const ina219_log_header_t *Adafruit_INA219_Log::header() {
+  return log_header;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the sequence number of the newest record, 0 if none
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA219_Log::head() {
+  return __atomic_load_n(&log_head, __ATOMIC_ACQUIRE);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the sequence number of the oldest record held
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA219_Log::oldest() {
+  return log_oldest;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the number of records found valid when opened
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA219_Log::getRecovered() {
+  return log_recovered;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Copies record 'seq', false if it's no longer (or not yet)
+            in the log
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Log::read(uint64_t seq, ina219_record_t *record) {
+  if (log_header == NULL || seq == 0)
+    return false;
+  const ina219_log_slot_t *slot = &log_slots[(seq - 1) & (log_header->slots - 1)];
+  if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq)
+    return false;
+  *record = slot->record;
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Stops the sync thread, syncs a last time and unmaps the file
+*/
+/**************************************************************************/
+void Adafruit_INA219_Log::close() {
+  if (log_syncing) {
+    pthread_mutex_lock(&log_syncLock);
+    log_syncing = false;
+    pthread_cond_signal(&log_syncStop);
+    pthread_mutex_unlock(&log_syncLock);
+    pthread_join(log_syncThread, NULL);
+  }
+  if (log_header != NULL)
+    munmap(log_header, log_size);
+  log_header = NULL;
+  log_slots = NULL;
+}
@@ -0,0 +1,97 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Log.h
+	@license  BSD (see license.txt)
+	
+	Crash-safe circular sample log in a memory-mapped file
+
+	The file is preallocated once: a header page then fixed-size
+	slots of one record each, written in place as plain memory stores
+	(the record, then its sequence number), so appending costs no
+	system call.  A sync thread msyncs the slots written since its
+	last pass and then records the last synced sequence number, the
+	commit index, in the header.  After a crash or power loss the log
+	is recovered on open by scanning the slots for the newest sequence
+	number stored in its own slot and walking back while numbers stay
+	consecutive: records up to the commit index are known durable,
+	later ones are kept if they passed the same check.  Slots numbered
+	past the recovered head are cleared so they can't pass for later
+	records after the next crash.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_LOG_H_
+#define _ADAFRUIT_INA219_LOG_H_
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "Adafruit_INA219_Ring.h"
+
+/*=========================================================================
+    LOG LAYOUT
+    -----------------------------------------------------------------------*/
+    #define INA219_LOG_MAGIC                       (0x4C414E49) // "INAL"
+    #define INA219_LOG_VERSION                     (1)
+    #define INA219_LOG_HEADER_SIZE                 (4096)
+    #define INA219_LOG_DEFAULT_SLOTS               (1 << 20)    // 32 MiB
+/*=========================================================================*/
+
+typedef struct {
+  uint64_t seq;             ///< Sequence number held, from 1; 0 if never written
+  ina219_record_t record;
+} ina219_log_slot_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slots;           ///< Number of slots, a power of 2
+  uint32_t slotSize;        ///< sizeof(ina219_log_slot_t)
+  uint64_t commit;          ///< Last sequence number known to be on disk
+  uint32_t sensors;
+  uint32_t reserved;
+  ina219_ring_sensor_t sensor[INA219_RING_MAX_SENSORS];
+} ina219_log_header_t;
+
+class Adafruit_INA219_Log{
+ public:
+  Adafruit_INA219_Log(void);
+  ~Adafruit_INA219_Log(void);
+  bool open(const char *path, uint32_t slots = INA219_LOG_DEFAULT_SLOTS, bool readOnly = false);
+  void setSensors(uint32_t sensors);
+  void setSensor(uint8_t index, uint8_t address, float currentLsb_mA);
+  uint64_t append(const ina219_record_t *record);
+  bool sync(void);
+  bool startSync(uint32_t period_ms);
+  const ina219_log_header_t *header(void);
+  uint64_t head(void);
+  uint64_t oldest(void);
+  uint64_t getRecovered(void);
+  bool read(uint64_t seq, ina219_record_t *record);
+  void close(void);
+
+ private:
+  ina219_log_header_t *log_header;
+  ina219_log_slot_t *log_slots;
+  size_t log_size;
+  uint64_t log_head;        // written by append() only
+  uint64_t log_oldest;
+  uint64_t log_synced;      // written by sync() only
+  uint64_t log_recovered;
+  uint32_t log_syncPeriod_ms;
+  bool log_syncing;
+  pthread_t log_syncThread;
+  pthread_mutex_t log_syncLock;
+  pthread_cond_t log_syncStop;
+
+  static bool unwritten(int fd, const struct stat *st);
+  void recover(bool readOnly);
+  bool syncSlots(uint64_t first, uint64_t last);
+  static void *syncLoop(void *self);
+};
+
+#endif
@@ -0,0 +1,269 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Metrics.cpp
+	@license  BSD (see license.txt)
+	
+	Prometheus text format metrics endpoint for the ina219d daemon
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "Adafruit_INA219_Metrics.h"
+
+// worst case text per sensor, 10 series of about 100 bytes
+#define METRICS_TEXT_PER_SENSOR                    (1200)
+#define METRICS_TEXT_HEADER                        (2048)
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates the endpoint, see begin()
+*/
+/**************************************************************************/
+Adafruit_INA219_Metrics::Adafruit_INA219_Metrics() {
+  metrics_state = NULL;
+  metrics_copy = NULL;
+  metrics_text = NULL;
+  metrics_textSize = 0;
+  metrics_sensors = 0;
+  metrics_fd = -1;
+  metrics_stopPipe[0] = metrics_stopPipe[1] = -1;
+  metrics_running = false;
+
+  // update() runs on the real-time sampling thread, a scrape holding
+  // the lock must not be preempted by anything of lower priority
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+  pthread_mutex_init(&metrics_lock, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+Adafruit_INA219_Metrics::~Adafruit_INA219_Metrics() {
+  end();
+  pthread_mutex_destroy(&metrics_lock);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Listens on 127.0.0.1:'port' for 'sensors' sensors, all
+            memory is allocated here.  Returns false if the port can't
+            be bound.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Metrics::begin(uint16_t port, uint32_t sensors) {
+  metrics_sensors = sensors;
+  metrics_state = (ina219_metrics_t *)calloc(sensors, sizeof(ina219_metrics_t));
+  metrics_copy = (ina219_metrics_t *)calloc(sensors, sizeof(ina219_metrics_t));
+  metrics_textSize = METRICS_TEXT_HEADER + sensors * METRICS_TEXT_PER_SENSOR;
+  metrics_text = (char *)malloc(metrics_textSize);
+  if (metrics_state == NULL || metrics_copy == NULL || metrics_text == NULL)
+    return false;
+
+  metrics_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (metrics_fd < 0)
+    return false;
+  int one = 1;
+  setsockopt(metrics_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(metrics_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(metrics_fd, 8) < 0 ||
+      pipe(metrics_stopPipe) < 0) {
+    end();
+    return false;
+  }
+
+  metrics_running = pthread_create(&metrics_thread, NULL, serve, this) == 0;
+  return metrics_running;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Folds a published record into the state of its sensor, this
+            is all the sampling loop pays for the endpoint
+*/
+/**************************************************************************/
+void Adafruit_INA219_Metrics::update(uint8_t index, const ina219_record_t *record,
+                                     float currentLsb_mA, uint32_t errors, uint32_t retries) {
+  if (index >= metrics_sensors)
+    return;
+
+  pthread_mutex_lock(&metrics_lock);
+  ina219_metrics_t *m = &metrics_state[index];
+  m->address = record->address;
+  m->errors = errors;
+  m->retries = retries;
+  if (record->status == 0) {
+    double power_W = record->power * (double)currentLsb_mA / 1e6;
+    // trapezoidal integration between consecutive good samples
+    if (m->samples)
+      m->energy_J += (power_W + m->power_W) / 2 * (record->time_ns - m->time_ns) / 1e9;
+    m->current_A = record->current * (double)currentLsb_mA / 1000;
+    m->shunt_V = record->shunt * 1e-5;
+    m->bus_V = record->bus * 1e-3;
+    m->power_W = power_W;
+    m->time_ns = record->time_ns;
+    m->samples++;
+    if (record->flags & 0x01)                // INA219_BUSVOLTAGE_OVF
+      m->overflows++;
+  }
+  pthread_mutex_unlock(&metrics_lock);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Formats the copied state in the Prometheus text format,
+            returns its length
+*/
+/**************************************************************************/
+size_t Adafruit_INA219_Metrics::render() {
+  static const struct {
+    const char *name;
+    const char *type;
+    const char *help;
+  } series[] = {
+    { "ina219_current_amperes", "gauge", "Current through the shunt" },
+    { "ina219_shunt_voltage_volts", "gauge", "Voltage across the shunt" },
+    { "ina219_bus_voltage_volts", "gauge", "Bus voltage on the load side" },
+    { "ina219_power_watts", "gauge", "Power delivered to the load" },
+    { "ina219_energy_joules_total", "counter", "Energy delivered since the daemon started" },
+    { "ina219_last_sample_timestamp_seconds", "gauge", "Time of the last good sample" },
+    { "ina219_samples_total", "counter", "Good samples read" },
+    { "ina219_overflows_total", "counter", "Samples with the math overflow flag set" },
+    { "ina219_i2c_errors_total", "counter", "Failed I2C transfers" },
+    { "ina219_i2c_retries_total", "counter", "Retried I2C transfers" },
+  };
+  size_t len = 0;
+
+  for (size_t s = 0; s < sizeof(series) / sizeof(series[0]); s++) {
+    len += snprintf(metrics_text + len, metrics_textSize - len, "# HELP %s %s\n# TYPE %s %s\n",
+                    series[s].name, series[s].help, series[s].name, series[s].type);
+    for (uint32_t i = 0; i < metrics_sensors && len < metrics_textSize; i++) {
+      const ina219_metrics_t *m = &metrics_copy[i];
+      double value;
+      switch (s) {
+        case 0: value = m->current_A; break;
+        case 1: value = m->shunt_V; break;
+        case 2: value = m->bus_V; break;
+        case 3: value = m->power_W; break;
+        case 4: value = m->energy_J; break;
+        case 5: value = m->time_ns / 1e9; break;
+        case 6: value = m->samples; break;
+        case 7: value = m->overflows; break;
+        case 8: value = m->errors; break;
+        default: value = m->retries; break;
+      }
+      len += snprintf(metrics_text + len, metrics_textSize - len,
+                      "%s{sensor=\"%u\",address=\"0x%02x\"} %.9g\n",
+                      series[s].name, i, m->address, value);
+    }
+    if (len >= metrics_textSize)
+      return metrics_textSize - 1;
+  }
+  return len;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Answers one HTTP request: /metrics (or /) gets the metrics,
+            anything else a 404
+*/
+/**************************************************************************/
+void Adafruit_INA219_Metrics::answer(int fd) {
+  char request[512];
+  char header[160];
+  struct pollfd pfd = { fd, POLLIN, 0 };
+
+  // a client that doesn't send its request quickly is dropped
+  if (poll(&pfd, 1, 1000) <= 0)
+    return;
+  ssize_t n = recv(fd, request, sizeof(request) - 1, 0);
+  if (n <= 0)
+    return;
+  request[n] = 0;
+
+  if (strncmp(request, "GET /metrics ", 13) != 0 && strncmp(request, "GET / ", 6) != 0) {
+    static const char notFound[] =
+      "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    send(fd, notFound, sizeof(notFound) - 1, MSG_NOSIGNAL);
+    return;
+  }
+
+  pthread_mutex_lock(&metrics_lock);
+  memcpy(metrics_copy, metrics_state, metrics_sensors * sizeof(ina219_metrics_t));
+  pthread_mutex_unlock(&metrics_lock);
+
+  size_t len = render();
+  int hlen = snprintf(header, sizeof(header),
+                      "HTTP/1.0 200 OK\r\n"
+                      "Content-Type: text/plain; version=0.0.4\r\n"
+                      "Content-Length: %zu\r\n"
+                      "Connection: close\r\n\r\n", len);
+  send(fd, header, hlen, MSG_NOSIGNAL | MSG_MORE);
+  send(fd, metrics_text, len, MSG_NOSIGNAL);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Server thread, one connection at a time
+*/
+/**************************************************************************/
+void *Adafruit_INA219_Metrics::serve(void *self) {
+  Adafruit_INA219_Metrics *metrics = (Adafruit_INA219_Metrics *)self;
+  struct pollfd pfd[2] = {
+    { metrics->metrics_fd, POLLIN, 0 },
+    { metrics->metrics_stopPipe[0], POLLIN, 0 },
+  };
+
+  for (;;) {
+    if (poll(pfd, 2, -1) < 0)
+      continue;
+    if (pfd[1].revents)
+      break;
+    int fd = accept4(metrics->metrics_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0)
+      continue;
+    metrics->answer(fd);
+    close(fd);
+  }
+  return NULL;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Stops the server thread and frees everything
+*/
+/**************************************************************************/
+void Adafruit_INA219_Metrics::end() {
+  if (metrics_running) {
+    if (write(metrics_stopPipe[1], "", 1) == 1)
+      pthread_join(metrics_thread, NULL);
+    metrics_running = false;
+  }
+  if (metrics_fd >= 0)
+    close(metrics_fd);
+  for (int i = 0; i < 2; i++)
+    if (metrics_stopPipe[i] >= 0)
+      close(metrics_stopPipe[i]);
+  metrics_fd = metrics_stopPipe[0] = metrics_stopPipe[1] = -1;
+  free(metrics_state);
+  free(metrics_copy);
+  free(metrics_text);
+  metrics_state = metrics_copy = NULL;
+  metrics_text = NULL;
+}
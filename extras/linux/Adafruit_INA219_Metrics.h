@@ -0,0 +1,66 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Metrics.h
+	@license  BSD (see license.txt)
+	
+	Prometheus text format metrics endpoint for the ina219d daemon
+
+	The sampling loop folds each sample into a small per-sensor state
+	(last values, accumulated energy, health counters); scrapes are
+	answered from a copy of that state by a separate thread on
+	127.0.0.1, so they never touch the I2C bus nor delay sampling.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_METRICS_H_
+#define _ADAFRUIT_INA219_METRICS_H_
+
+#include <pthread.h>
+
+#include "Adafruit_INA219_Ring.h"
+
+typedef struct {
+  uint8_t address;
+  double current_A;
+  double shunt_V;
+  double bus_V;
+  double power_W;
+  double energy_J;          ///< Integral of power over the samples
+  uint64_t time_ns;         ///< Time of the last sample
+  uint64_t samples;
+  uint64_t overflows;       ///< Samples with the OVF flag set
+  uint32_t errors;          ///< Failed I2C transfers
+  uint32_t retries;
+} ina219_metrics_t;
+
+class Adafruit_INA219_Metrics{
+ public:
+  Adafruit_INA219_Metrics(void);
+  ~Adafruit_INA219_Metrics(void);
+  bool begin(uint16_t port, uint32_t sensors);
+  void update(uint8_t index, const ina219_record_t *record, float currentLsb_mA,
+              uint32_t errors, uint32_t retries);
+  void end(void);
+
+ private:
+  ina219_metrics_t *metrics_state;
+  ina219_metrics_t *metrics_copy;
+  char *metrics_text;
+  size_t metrics_textSize;
+  uint32_t metrics_sensors;
+  int metrics_fd;
+  int metrics_stopPipe[2];
+  pthread_t metrics_thread;
+  pthread_mutex_t metrics_lock;
+  bool metrics_running;
+
+  static void *serve(void *self);
+  void answer(int fd);
+  size_t render(void);
+};
+
+#endif
@@ -0,0 +1,316 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Ring.cpp
+	@license  BSD (see license.txt)
+	
+	Shared-memory sample ring between ina219d and local readers
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Adafruit_INA219_Ring.h"
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the size of a ring mapping with 'slots' slots
+*/
+/**************************************************************************/
+static size_t ringSize(uint32_t slots)
+{
+  return sizeof(ina219_ring_header_t) + (size_t)slots * sizeof(ina219_ring_slot_t);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates a ring writer, see create()
+*/
+/**************************************************************************/
+Adafruit_INA219_RingWriter::Adafruit_INA219_RingWriter() {
+  ring_header = NULL;
+  ring_slots = NULL;
+  ring_size = 0;
+  ring_seq = 0;
+}
+
+Adafruit_INA219_RingWriter::~Adafruit_INA219_RingWriter() {
+  close();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Creates (or replaces) the shared memory object 'name' with
+            'slots' slots, rounded up to a power of 2.  Returns false if
+            it can't be created or mapped.  A ring being replaced is
+            unlinked rather than truncated, readers still mapping it
+            would fault on the truncated pages.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_RingWriter::create(const char *name, uint32_t slots,
+                                        uint32_t sensors, uint64_t period_ns) {
+  uint32_t n = 1;
+  while (n < slots)
+    n <<= 1;
+  if (sensors > INA219_RING_MAX_SENSORS)
+    return false;
+
+  close();
+  shm_unlink(name);
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0)
+    return false;
+
+  ring_size = ringSize(n);
+  void *map = MAP_FAILED;
+  if (ftruncate(fd, ring_size) == 0)
+    map = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+    return false;
+
+  ring_header = (ina219_ring_header_t *)map;
+  ring_slots = (ina219_ring_slot_t *)(ring_header + 1);
+  ring_seq = 0;
+
+  // the file is zeroed by ftruncate, which is a valid empty ring with
+  // every slot's seq at 0; the magic goes last so readers see either
+  // nothing or a complete header
+  ring_header->version = INA219_RING_VERSION;
+  ring_header->slots = n;
+  ring_header->sensors = sensors;
+  ring_header->period_ns = period_ns;
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ring_header->epoch = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  std::atomic_thread_fence(std::memory_order_release);
+  ring_header->magic = INA219_RING_MAGIC;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Describes sensor 'index' for the readers
+*/
+/**************************************************************************/
+void Adafruit_INA219_RingWriter::setSensor(uint8_t index, uint8_t address, float currentLsb_mA) {
+  if (ring_header == NULL || index >= ring_header->sensors)
+    return;
+  ring_header->sensor[index].address = address;
+  ring_header->sensor[index].currentLsb_mA = currentLsb_mA;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Publishes a record and returns its sequence number (from 1)
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA219_RingWriter::publish(const ina219_record_t *record) {
+  uint64_t seq = ++ring_seq;
+  ina219_ring_slot_t *slot = &ring_slots[(seq - 1) & (ring_header->slots - 1)];
+
+  slot->seq.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->record = *record;
+  slot->seq.store(seq, std::memory_order_release);
+  ring_header->head.store(seq, std::memory_order_release);
+  return seq;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Unmaps the ring, readers keep their mapping
+*/
+/**************************************************************************/
+void Adafruit_INA219_RingWriter::close() {
+  if (ring_header != NULL)
+    munmap(ring_header, ring_size);
+  ring_header = NULL;
+  ring_slots = NULL;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates a ring reader, see open()
+*/
+/**************************************************************************/
+Adafruit_INA219_RingReader::Adafruit_INA219_RingReader() {
+  ring_header = NULL;
+  ring_slots = NULL;
+  ring_size = 0;
+  ring_name[0] = 0;
+}
+
+Adafruit_INA219_RingReader::~Adafruit_INA219_RingReader() {
+  close();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Maps the ring 'name' read-only, returns false if it doesn't
+            exist or isn't a ring of this version
+*/
+/**************************************************************************/
+bool Adafruit_INA219_RingReader::open(const char *name) {
+  close();
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  void *map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ina219_ring_header_t))
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+    return false;
+
+  ring_header = (const ina219_ring_header_t *)map;
+  ring_size = st.st_size;
+  if (ring_header->magic != INA219_RING_MAGIC ||
+      ring_header->version != INA219_RING_VERSION ||
+      ringSize(ring_header->slots) > ring_size) {
+    close();
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  ring_slots = (const ina219_ring_slot_t *)(ring_header + 1);
+  strncpy(ring_name, name, NAME_MAX);
+  ring_name[NAME_MAX] = 0;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Unmaps the ring
+*/
+/**************************************************************************/
+void Adafruit_INA219_RingReader::close() {
+  if (ring_header != NULL)
+    munmap((void *)ring_header, ring_size);
+  ring_header = NULL;
+  ring_slots = NULL;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the ring header (slots, sensors and their current
+            LSB for converting records)
+*/
+/**************************************************************************/
+const ina219_ring_header_t *Adafruit_INA219_RingReader::header() {
+  return ring_header;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the sequence number of the newest record, 0 if none
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA219_RingReader::head() {
+  return ring_header->head.load(std::memory_order_acquire);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the sequence number of the oldest record still in
+            the ring
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA219_RingReader::oldest() {
+  uint64_t h = head();
+  return (h > ring_header->slots) ? h - ring_header->slots + 1 : 1;
+}
+
+const ina219_ring_slot_t *Adafruit_INA219_RingReader::slot(uint64_t seq) {
+  return &ring_slots[(seq - 1) & (ring_header->slots - 1)];
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Zero-copy access: returns the record 'seq' in place, or NULL
+            if it isn't in the ring (not written yet or overwritten).
+            The daemon may overwrite it at any time, so check valid()
+            after using it and drop what was read if it fails.
+*/
+/**************************************************************************/
+const ina219_record_t *Adafruit_INA219_RingReader::peek(uint64_t seq) {
+  if (seq == 0 || slot(seq)->seq.load(std::memory_order_acquire) != seq)
+    return NULL;
+  return &slot(seq)->record;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns true if record 'seq' is still in place, i.e. what
+            was read from peek() since is consistent
+*/
+/**************************************************************************/
+bool Adafruit_INA219_RingReader::valid(uint64_t seq) {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot(seq)->seq.load(std::memory_order_relaxed) == seq;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Copies record '*next' and advances '*next'.  Returns 1 when a
+            record was copied, 0 when there is no new record yet and -1
+            when the reader fell behind by more than the ring size, in
+            which case '*next' jumps to the oldest record available.
+            Start with *next = head() + 1 for new records only.  A
+            '*next' past head() + 1, e.g. kept from a replaced ring,
+            also returns -1 and jumps to the oldest record.
+*/
+/**************************************************************************/
+int Adafruit_INA219_RingReader::read(uint64_t *next, ina219_record_t *record) {
+  uint64_t h = head();
+
+  if (*next == 0)
+    *next = 1;
+  if (*next > h + 1) {
+    *next = oldest();
+    return -1;
+  }
+  if (*next > h)
+    return 0;
+
+  const ina219_record_t *r = peek(*next);
+  if (r != NULL) {
+    *record = *r;
+    if (valid(*next)) {
+      (*next)++;
+      return 1;
+    }
+  }
+  *next = oldest();
+  return -1;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns true if the daemon has replaced the ring since it
+            was opened: the mapping stays valid but won't get new
+            records, open() it again and restart from head() + 1.
+            Makes system calls, check it while idle, not per record.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_RingReader::replaced() {
+  ina219_ring_header_t current;
+
+  if (ring_header == NULL)
+    return false;
+  int fd = shm_open(ring_name, O_RDONLY, 0);
+  if (fd < 0)
+    return false;
+  ssize_t got = pread(fd, &current, sizeof(current), 0);
+  ::close(fd);
+  return got == (ssize_t)sizeof(current) && current.magic == INA219_RING_MAGIC &&
+         current.epoch != ring_header->epoch;
+}
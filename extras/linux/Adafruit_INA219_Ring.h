@@ -0,0 +1,123 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Ring.h
+	@license  BSD (see license.txt)
+	
+	Shared-memory sample ring between the ina219d sampling daemon and
+	any number of local readers
+
+	The daemon is the only process talking to the sensors; it
+	publishes raw samples into a ring in /dev/shm.  Readers map it
+	read-only and access records in place: every slot carries the
+	sequence number of the record it holds, written last by the
+	daemon, so a reader checks it before and after using a record to
+	know the record wasn't overwritten meanwhile (a seqlock).  Readers
+	never write to the ring, so attaching more of them changes
+	neither the bus load nor the daemon's work.
+
+	A restarted daemon unlinks the old ring and creates a new one with
+	a new epoch, so readers keep a valid mapping of the old one and
+	notice the change through replaced().
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_RING_H_
+#define _ADAFRUIT_INA219_RING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include <atomic>
+
+/*=========================================================================
+    RING LAYOUT
+    -----------------------------------------------------------------------*/
+    #define INA219_RING_MAGIC                      (0x39314E49) // "INA9"
+    #define INA219_RING_VERSION                    (2)
+    #define INA219_RING_DEFAULT_NAME               "/ina219"    // /dev/shm/ina219
+    #define INA219_RING_MAX_SENSORS                (64)
+/*=========================================================================*/
+
+typedef struct {
+  uint64_t time_ns;   ///< CLOCK_REALTIME when the sample was read
+  uint8_t sensor;     ///< Index of the sensor in the daemon's list
+  uint8_t address;    ///< I2C address of the sensor
+  uint8_t flags;      ///< CNVR / OVF from the bus voltage read
+  uint8_t status;     ///< INA219_OK or the INA219_ERR_* of the read
+  int16_t shunt;      ///< Raw shunt voltage, 10uV per bit
+  int16_t bus;        ///< Raw bus voltage in mV
+  int16_t current;    ///< Current in current LSBs
+  int16_t reserved;
+  int32_t power;      ///< Power in current LSB x 1mV
+} ina219_record_t;
+
+typedef struct {
+  float currentLsb_mA;  ///< mA per current LSB
+  uint8_t address;      ///< I2C address
+  uint8_t reserved[3];
+} ina219_ring_sensor_t;
+
+// one slot per cache line so the daemon's stores and the readers'
+// loads of neighbouring slots don't share lines
+typedef struct {
+  std::atomic<uint64_t> seq;  ///< Sequence number held, 0 while written
+  ina219_record_t record;
+  uint8_t pad[64 - sizeof(uint64_t) - sizeof(ina219_record_t)];
+} ina219_ring_slot_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slots;             ///< Number of slots, a power of 2
+  uint32_t sensors;           ///< Number of sensors sampled
+  uint64_t period_ns;         ///< Sampling period of each sensor
+  std::atomic<uint64_t> head; ///< Last sequence number published
+  uint64_t epoch;             ///< CLOCK_REALTIME when the ring was created
+  uint8_t pad[24];
+  ina219_ring_sensor_t sensor[INA219_RING_MAX_SENSORS];
+} ina219_ring_header_t;
+
+class Adafruit_INA219_RingWriter{
+ public:
+  Adafruit_INA219_RingWriter(void);
+  ~Adafruit_INA219_RingWriter(void);
+  bool create(const char *name, uint32_t slots, uint32_t sensors, uint64_t period_ns);
+  void setSensor(uint8_t index, uint8_t address, float currentLsb_mA);
+  uint64_t publish(const ina219_record_t *record);
+  void close(void);
+
+ private:
+  ina219_ring_header_t *ring_header;
+  ina219_ring_slot_t *ring_slots;
+  size_t ring_size;
+  uint64_t ring_seq;
+};
+
+class Adafruit_INA219_RingReader{
+ public:
+  Adafruit_INA219_RingReader(void);
+  ~Adafruit_INA219_RingReader(void);
+  bool open(const char *name = INA219_RING_DEFAULT_NAME);
+  void close(void);
+  const ina219_ring_header_t *header(void);
+  uint64_t head(void);
+  uint64_t oldest(void);
+  const ina219_record_t *peek(uint64_t seq);
+  bool valid(uint64_t seq);
+  int read(uint64_t *next, ina219_record_t *record);
+  bool replaced(void);
+
+ private:
+  const ina219_ring_header_t *ring_header;
+  const ina219_ring_slot_t *ring_slots;
+  size_t ring_size;
+  char ring_name[NAME_MAX + 1];
+
+  const ina219_ring_slot_t *slot(uint64_t seq);
+};
+
+#endif
@@ -0,0 +1,262 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Rollup.cpp
+	@license  BSD (see license.txt)
+	
+	Incremental multi-resolution rollups of the samples of many sensors
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "Adafruit_INA219_Rollup.h"
+
+static const uint32_t levelDuration_s[INA219_ROLLUP_LEVELS] = { 1, 60, 3600 };
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates a store, see begin()
+*/
+/**************************************************************************/
+Adafruit_INA219_Rollup::Adafruit_INA219_Rollup() {
+  memset(rollup_levels, 0, sizeof(rollup_levels));
+  rollup_sensors = NULL;
+  rollup_sensorCount = 0;
+}
+
+Adafruit_INA219_Rollup::~Adafruit_INA219_Rollup() {
+  end();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Allocates all buckets for 'sensors' sensors; 'kept' gives
+            the number of buckets per level, NULL for the defaults.
+            Nothing is allocated afterwards.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Rollup::begin(uint8_t sensors, const uint32_t *kept) {
+  static const uint32_t defaultKept[INA219_ROLLUP_LEVELS] = {
+    INA219_ROLLUP_SECONDS_KEPT, INA219_ROLLUP_MINUTES_KEPT, INA219_ROLLUP_HOURS_KEPT
+  };
+
+  end();
+  if (kept == NULL)
+    kept = defaultKept;
+  rollup_sensorCount = sensors;
+  rollup_sensors = (sensor *)calloc(sensors, sizeof(sensor));
+  if (rollup_sensors == NULL)
+    return false;
+  for (uint8_t s = 0; s < sensors; s++)
+    for (int l = 0; l < INA219_ROLLUP_LEVELS; l++)
+      rollup_sensors[s].newest[l] = -1;
+
+  for (int l = 0; l < INA219_ROLLUP_LEVELS; l++) {
+    if (kept[l] == 0) {
+      end();
+      return false;
+    }
+    rollup_levels[l].kept = kept[l];
+    // calloc: count 0 marks a bucket empty
+    rollup_levels[l].buckets = (ina219_rollup_t *)calloc((size_t)kept[l] * sensors,
+                                                         sizeof(ina219_rollup_t));
+    if (rollup_levels[l].buckets == NULL) {
+      end();
+      return false;
+    }
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the bucket duration of a level in seconds
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Rollup::getDuration_s(uint8_t level) {
+  return (level < INA219_ROLLUP_LEVELS) ? levelDuration_s[level] : 0;
+}
+
+static inline void foldStat(ina219_stat_t *stat, float value, bool first) {
+  if (first) {
+    stat->min = stat->max = value;
+    stat->sum = value;
+    return;
+  }
+  if (value < stat->min)
+    stat->min = value;
+  if (value > stat->max)
+    stat->max = value;
+  stat->sum += value;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Adds a sample read at 'time_ns' (CLOCK_REALTIME) to the
+            buckets of all levels.  Energy is integrated from the
+            previous sample of the sensor.  Returns a bitmask of the
+            levels where the sample opened a new bucket, i.e. the
+            previous one is complete.
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219_Rollup::add(uint8_t sensor, uint64_t time_ns, float current_mA,
+                                    float bus_V, float power_mW) {
+  if (sensor >= rollup_sensorCount)
+    return 0;
+
+  struct sensor *s = &rollup_sensors[sensor];
+  double energy_J = 0;
+  if (s->last_ns != 0 && time_ns > s->last_ns &&
+      time_ns - s->last_ns <= (uint64_t)INA219_ROLLUP_MAX_GAP_S * 1000000000) {
+    // trapezoid, mW x ns to J
+    energy_J = (power_mW + s->lastPower_mW) / 2.0 * (time_ns - s->last_ns) / 1e12;
+  }
+  s->last_ns = time_ns;
+  s->lastPower_mW = power_mW;
+
+  int64_t time_s = time_ns / 1000000000;
+  uint8_t closed = 0;
+  for (int l = 0; l < INA219_ROLLUP_LEVELS; l++) {
+    int64_t index = time_s / levelDuration_s[l];
+    int64_t start_s = index * levelDuration_s[l];
+    ina219_rollup_t *b = &rollup_levels[l].buckets[(size_t)sensor * rollup_levels[l].kept +
+                                                   index % rollup_levels[l].kept];
+    if (index > s->newest[l]) {
+      if (s->newest[l] >= 0)
+        closed |= 1 << l;
+      s->newest[l] = index;
+    }
+    if (b->start_s != start_s || b->count == 0) {
+      // an older sample whose bucket was already recycled is dropped
+      if (index + (int64_t)rollup_levels[l].kept <= s->newest[l])
+        continue;
+      b->start_s = start_s;
+      b->count = 0;
+      b->energy_J = 0;
+    }
+    bool first = b->count == 0;
+    foldStat(&b->current_mA, current_mA, first);
+    foldStat(&b->bus_V, bus_V, first);
+    foldStat(&b->power_mW, power_mW, first);
+    b->energy_J += energy_J;
+    b->count++;
+  }
+  return closed;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Copies into 'buckets' (up to 'max') the non-empty buckets of
+            'level' starting in [from_s, to_s), oldest first.  Returns
+            how many were copied; buckets older than the level keeps
+            are gone.
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Rollup::query(uint8_t sensor, uint8_t level, int64_t from_s, int64_t to_s,
+                                       ina219_rollup_t *buckets, uint32_t max) {
+  if (sensor >= rollup_sensorCount || level >= INA219_ROLLUP_LEVELS || to_s <= from_s)
+    return 0;
+
+  const struct level *lv = &rollup_levels[level];
+  uint32_t d = levelDuration_s[level];
+  int64_t newest = rollup_sensors[sensor].newest[level];
+  int64_t first = (from_s + d - 1) / d;
+  int64_t last = (to_s - 1) / d;
+  uint32_t n = 0;
+
+  if (newest < 0)
+    return 0;
+  if (first < newest - (int64_t)lv->kept + 1)
+    first = newest - lv->kept + 1;
+  if (last > newest)
+    last = newest;
+
+  for (int64_t index = first; index <= last && n < max; index++) {
+    const ina219_rollup_t *b = &lv->buckets[(size_t)sensor * lv->kept + index % lv->kept];
+    if (b->count != 0 && b->start_s == index * d)
+      buckets[n++] = *b;
+  }
+  return n;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Adds the bucket 'from' into 'into', count 0 'into' is empty
+*/
+/**************************************************************************/
+void Adafruit_INA219_Rollup::merge(ina219_rollup_t *into, const ina219_rollup_t *from) {
+  if (from->count == 0)
+    return;
+  if (into->count == 0) {
+    *into = *from;
+    return;
+  }
+  const ina219_stat_t *src[3] = { &from->current_mA, &from->bus_V, &from->power_mW };
+  ina219_stat_t *dst[3] = { &into->current_mA, &into->bus_V, &into->power_mW };
+  for (int i = 0; i < 3; i++) {
+    if (src[i]->min < dst[i]->min)
+      dst[i]->min = src[i]->min;
+    if (src[i]->max > dst[i]->max)
+      dst[i]->max = src[i]->max;
+    dst[i]->sum += src[i]->sum;
+  }
+  if (from->start_s < into->start_s)
+    into->start_s = from->start_s;
+  into->count += from->count;
+  into->energy_J += from->energy_J;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Merges the buckets of 'level' starting in [from_s, to_s)
+            into 'summary'; false if there are none
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Rollup::summarize(uint8_t sensor, uint8_t level, int64_t from_s, int64_t to_s,
+                                       ina219_rollup_t *summary) {
+  ina219_rollup_t chunk[64];
+  int64_t d = getDuration_s(level);
+
+  memset(summary, 0, sizeof(*summary));
+  while (from_s < to_s) {
+    uint32_t n = query(sensor, level, from_s, to_s, chunk, 64);
+    if (n == 0)
+      break;
+    for (uint32_t i = 0; i < n; i++)
+      merge(summary, &chunk[i]);
+    from_s = chunk[n - 1].start_s + d;
+  }
+  return summary->count != 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the bytes allocated by begin()
+*/
+/**************************************************************************/
+size_t Adafruit_INA219_Rollup::getMemory() {
+  size_t bytes = (size_t)rollup_sensorCount * sizeof(sensor);
+  for (int l = 0; l < INA219_ROLLUP_LEVELS; l++)
+    bytes += (size_t)rollup_levels[l].kept * rollup_sensorCount * sizeof(ina219_rollup_t);
+  return bytes;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Frees all buckets
+*/
+/**************************************************************************/
+void Adafruit_INA219_Rollup::end() {
+  for (int l = 0; l < INA219_ROLLUP_LEVELS; l++) {
+    free(rollup_levels[l].buckets);
+    rollup_levels[l].buckets = NULL;
+    rollup_levels[l].kept = 0;
+  }
+  free(rollup_sensors);
+  rollup_sensors = NULL;
+  rollup_sensorCount = 0;
+}
@@ -0,0 +1,91 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Rollup.h
+	@license  BSD (see license.txt)
+	
+	Incremental multi-resolution rollups (1 s / 1 min / 1 h) of the
+	samples of many sensors, for long-term trends
+
+	Each level is a fixed ring of buckets per sensor, indexed by the
+	bucket start time modulo the ring length, so adding a sample is a
+	constant number of operations (one bucket per level) and the
+	memory is set once in begin(): with the default lengths, an hour of
+	seconds, a week of minutes and a year of hours, about 1.6 MB per
+	sensor.  Range queries read the buckets still held at a level and
+	never need the raw samples.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_ROLLUP_H_
+#define _ADAFRUIT_INA219_ROLLUP_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*=========================================================================
+    ROLLUP LEVELS
+    -----------------------------------------------------------------------*/
+    #define INA219_ROLLUP_LEVELS                   (3)
+    #define INA219_ROLLUP_SECOND                   (0)
+    #define INA219_ROLLUP_MINUTE                   (1)
+    #define INA219_ROLLUP_HOUR                     (2)
+    // default number of buckets kept per level
+    #define INA219_ROLLUP_SECONDS_KEPT             (3600)   // 1 hour
+    #define INA219_ROLLUP_MINUTES_KEPT             (10080)  // 1 week
+    #define INA219_ROLLUP_HOURS_KEPT               (8784)   // 366 days
+    // longer gaps between samples add no energy
+    #define INA219_ROLLUP_MAX_GAP_S                (10)
+/*=========================================================================*/
+
+typedef struct {
+  float min;
+  float max;
+  double sum;               ///< mean = sum / count
+} ina219_stat_t;
+
+typedef struct {
+  int64_t start_s;          ///< Bucket start, seconds since the epoch
+  uint32_t count;           ///< Samples in the bucket, 0 if empty
+  ina219_stat_t current_mA;
+  ina219_stat_t bus_V;
+  ina219_stat_t power_mW;
+  double energy_J;          ///< Energy delivered during the bucket
+} ina219_rollup_t;
+
+class Adafruit_INA219_Rollup{
+ public:
+  Adafruit_INA219_Rollup(void);
+  ~Adafruit_INA219_Rollup(void);
+  bool begin(uint8_t sensors, const uint32_t *kept = NULL);
+  uint8_t add(uint8_t sensor, uint64_t time_ns, float current_mA, float bus_V, float power_mW);
+  uint32_t query(uint8_t sensor, uint8_t level, int64_t from_s, int64_t to_s,
+                 ina219_rollup_t *buckets, uint32_t max);
+  bool summarize(uint8_t sensor, uint8_t level, int64_t from_s, int64_t to_s,
+                 ina219_rollup_t *summary);
+  size_t getMemory(void);
+  void end(void);
+
+  static uint32_t getDuration_s(uint8_t level);
+  static void merge(ina219_rollup_t *into, const ina219_rollup_t *from);
+
+ private:
+  struct level {
+    ina219_rollup_t *buckets;   // kept x sensors, sensor major
+    uint32_t kept;
+  };
+  struct sensor {
+    uint64_t last_ns;
+    float lastPower_mW;
+    int64_t newest[INA219_ROLLUP_LEVELS];   // newest bucket index
+  };
+
+  level rollup_levels[INA219_ROLLUP_LEVELS];
+  sensor *rollup_sensors;
+  uint8_t rollup_sensorCount;
+};
+
+#endif
@@ -0,0 +1,334 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Scheduler.cpp
+	@license  BSD (see license.txt)
+	
+	Periodic task scheduler for Linux hosts, on timerfd and epoll
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <errno.h>
+#include <math.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "Adafruit_INA219_Scheduler.h"
+
+// epoll tag of the stop eventfd, periods use their index
+#define SCHED_STOP_TAG                             (0xFFFFFFFF)
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates a scheduler, see begin()
+*/
+/**************************************************************************/
+Adafruit_INA219_Scheduler::Adafruit_INA219_Scheduler() {
+  sched_taskCount = 0;
+  sched_periodCount = 0;
+  sched_epoll = -1;
+  sched_stopFd = -1;
+  sched_late_ns = (uint64_t)INA219_SCHED_LATE_US * 1000;
+  sched_start_ns = 0;
+  sched_running = false;
+}
+
+Adafruit_INA219_Scheduler::~Adafruit_INA219_Scheduler() {
+  end();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads CLOCK_MONOTONIC, the clock of all deadlines
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA219_Scheduler::now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Creates the epoll set; tasks added afterwards all start
+            from the same instant, so equal periods stay in phase
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Scheduler::begin() {
+  sched_epoll = epoll_create1(EPOLL_CLOEXEC);
+  sched_stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (sched_epoll < 0 || sched_stopFd < 0) {
+    end();
+    return false;
+  }
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.u32 = SCHED_STOP_TAG;
+  epoll_ctl(sched_epoll, EPOLL_CTL_ADD, sched_stopFd, &ev);
+
+  // leave a millisecond for the tasks to be added before the first deadline
+  sched_start_ns = now_ns() + 1000000;
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Runs 'fn(arg, deadline)' every 'period_us' microseconds, first at one
+            period after begin().  Returns the task id, or -1 if a
+            limit is reached or the timer can't be created.
+*/
+/**************************************************************************/
+int Adafruit_INA219_Scheduler::add(uint32_t period_us, ina219_task_t fn, void *arg) {
+  int p;
+
+  if (sched_epoll < 0 || period_us == 0 || sched_taskCount == INA219_SCHED_MAX_TASKS)
+    return -1;
+
+  for (p = 0; p < sched_periodCount; p++)
+    if (sched_periods[p].period_us == period_us)
+      break;
+
+  if (p == sched_periodCount) {
+    if (p == INA219_SCHED_MAX_PERIODS)
+      return -1;
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (fd < 0)
+      return -1;
+
+    uint64_t first_ns = sched_start_ns + (uint64_t)period_us * 1000;
+    struct itimerspec its;
+    its.it_value.tv_sec = first_ns / 1000000000;
+    its.it_value.tv_nsec = first_ns % 1000000000;
+    its.it_interval.tv_sec = period_us / 1000000;
+    its.it_interval.tv_nsec = (long)(period_us % 1000000) * 1000;
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u32 = p;
+    if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL) < 0 ||
+        epoll_ctl(sched_epoll, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      close(fd);
+      return -1;
+    }
+    sched_periods[p].fd = fd;
+    sched_periods[p].period_us = period_us;
+    sched_periods[p].next_ns = first_ns;
+    sched_periodCount++;
+  }
+
+  task *t = &sched_tasks[sched_taskCount];
+  t->fn = fn;
+  t->arg = arg;
+  t->period = p;
+  sched_taskCount++;
+  resetStats();
+  return sched_taskCount - 1;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Runs later than 'late_us' past the deadline count as late
+*/
+/**************************************************************************/
+void Adafruit_INA219_Scheduler::setLateThreshold_us(uint32_t late_us) {
+  sched_late_ns = (uint64_t)late_us * 1000;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Runs the tasks of a period that expired: a read of the
+            timerfd gives the expirations since the last one, all but
+            the latest of them were missed
+*/
+/**************************************************************************/
+void Adafruit_INA219_Scheduler::expire(period *p, int index) {
+  uint64_t expirations;
+
+  if (read(p->fd, &expirations, sizeof(expirations)) != sizeof(expirations) || expirations == 0)
+    return;
+
+  uint64_t period_ns = (uint64_t)p->period_us * 1000;
+  uint64_t deadline_ns = p->next_ns + (expirations - 1) * period_ns;
+  p->next_ns = deadline_ns + period_ns;
+
+  for (int i = 0; i < sched_taskCount; i++) {
+    task *t = &sched_tasks[i];
+    if (t->period != index)
+      continue;
+
+    uint64_t now = now_ns();
+    uint64_t lateness = (now > deadline_ns) ? now - deadline_ns : 0;
+    t->missed += expirations - 1;
+    t->runs++;
+    if (lateness > sched_late_ns)
+      t->late++;
+    if (lateness < t->min_ns)
+      t->min_ns = lateness;
+    if (lateness > t->max_ns)
+      t->max_ns = lateness;
+    double delta = lateness - t->mean_ns;
+    t->mean_ns += delta / t->runs;
+    t->m2 += delta * (lateness - t->mean_ns);
+
+    t->fn(t->arg, deadline_ns);
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Waits up to 'timeout_ms' (-1 forever) for deadlines and runs
+            the tasks due.  Returns the number of periods served, 0 on
+            timeout or stop(), -1 on error.
+*/
+/**************************************************************************/
+int Adafruit_INA219_Scheduler::runOnce(int timeout_ms) {
+  struct epoll_event events[INA219_SCHED_MAX_PERIODS + 1];
+  int served = 0;
+
+  int n = epoll_wait(sched_epoll, events, INA219_SCHED_MAX_PERIODS + 1, timeout_ms);
+  if (n < 0)
+    return -1;
+  for (int i = 0; i < n; i++) {
+    if (events[i].data.u32 == SCHED_STOP_TAG) {
+      uint64_t value;
+      if (read(sched_stopFd, &value, sizeof(value)) == sizeof(value))
+        sched_running = false;
+      continue;
+    }
+    expire(&sched_periods[events[i].data.u32], events[i].data.u32);
+    served++;
+  }
+  return served;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Serves deadlines until stop(); returns 0, or -1 on error
+            other than a signal
+*/
+/**************************************************************************/
+int Adafruit_INA219_Scheduler::run() {
+  sched_running = true;
+  while (sched_running)
+    if (runOnce(-1) < 0 && errno != EINTR)
+      return -1;
+  return 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Makes run() return; safe from a signal handler or another
+            thread
+*/
+/**************************************************************************/
+void Adafruit_INA219_Scheduler::stop() {
+  uint64_t one = 1;
+  if (write(sched_stopFd, &one, sizeof(one)) < 0)
+    sched_running = false;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Touches the stack the thread may use so its pages are
+            mapped (and locked) before sampling starts
+*/
+/**************************************************************************/
+static void __attribute__((noinline)) prefaultStack(void) {
+  volatile char stack[INA219_SCHED_PREFAULT_STACK];
+  memset((char *)stack, 0, sizeof(stack));
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sets up the calling thread, the one to call run(), for real
+            time: SCHED_FIFO at 'priority' (0 leaves the policy), pinned
+            to 'cpu' (-1 leaves the affinity) and, with 'lockMemory',
+            all present and future memory of the process locked and the
+            stack prefaulted.  Returns false with errno set at the
+            first step that failed, usually for lack of CAP_SYS_NICE /
+            CAP_IPC_LOCK or RLIMIT_RTPRIO / RLIMIT_MEMLOCK.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Scheduler::setRealtime(int priority, int cpu, bool lockMemory) {
+  int err;
+
+  if (cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if ((err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) != 0) {
+      errno = err;
+      return false;
+    }
+  }
+  if (lockMemory) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+      return false;
+    prefaultStack();
+  }
+  if (priority > 0) {
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    if ((err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) != 0) {
+      errno = err;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Gets the counters and lateness statistics of task 'id'
+*/
+/**************************************************************************/
+void Adafruit_INA219_Scheduler::getStats(int id, ina219_sched_stats_t *stats) {
+  const task *t = &sched_tasks[id];
+
+  stats->runs = t->runs;
+  stats->late = t->late;
+  stats->missed = t->missed;
+  stats->min_ns = t->runs ? t->min_ns : 0;
+  stats->max_ns = t->max_ns;
+  stats->mean_ns = t->mean_ns;
+  stats->stddev_ns = (t->runs > 1) ? sqrt(t->m2 / (t->runs - 1)) : 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Clears the counters and statistics of all tasks
+*/
+/**************************************************************************/
+void Adafruit_INA219_Scheduler::resetStats() {
+  for (int i = 0; i < sched_taskCount; i++) {
+    task *t = &sched_tasks[i];
+    t->runs = t->late = t->missed = t->max_ns = 0;
+    t->min_ns = UINT64_MAX;
+    t->mean_ns = t->m2 = 0;
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Closes all timers, the tasks are forgotten
+*/
+/**************************************************************************/
+void Adafruit_INA219_Scheduler::end() {
+  for (int p = 0; p < sched_periodCount; p++)
+    close(sched_periods[p].fd);
+  if (sched_stopFd >= 0)
+    close(sched_stopFd);
+  if (sched_epoll >= 0)
+    close(sched_epoll);
+  sched_periodCount = sched_taskCount = 0;
+  sched_stopFd = sched_epoll = -1;
+}
@@ -0,0 +1,94 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Scheduler.h
+	@license  BSD (see license.txt)
+	
+	Periodic task scheduler for Linux hosts, on timerfd and epoll
+
+	Tasks sharing a period share one timerfd armed on absolute
+	CLOCK_MONOTONIC deadlines, so periods never drift with the time
+	the tasks take; all timerfds are multiplexed by a single epoll in
+	the calling thread.  Each task keeps the lateness of its runs
+	(wake-up latency from its deadline), late runs (over a threshold)
+	and missed deadlines (timer expirations that found the loop busy,
+	as counted by the kernel).  setRealtime() makes the calling
+	thread a SCHED_FIFO one pinned to a core, with its memory locked
+	and its stack prefaulted, against preemption and page faults.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_SCHEDULER_H_
+#define _ADAFRUIT_INA219_SCHEDULER_H_
+
+#include <stdint.h>
+
+/*=========================================================================
+    SCHEDULER LIMITS
+    -----------------------------------------------------------------------*/
+    #define INA219_SCHED_MAX_TASKS                 (256)
+    #define INA219_SCHED_MAX_PERIODS               (32)
+    #define INA219_SCHED_LATE_US                   (1000)  // default late threshold
+    #define INA219_SCHED_PREFAULT_STACK            (256 * 1024)
+/*=========================================================================*/
+
+typedef void (*ina219_task_t)(void *arg, uint64_t deadline_ns);
+
+typedef struct {
+  uint64_t runs;
+  uint64_t late;            ///< Runs started more than the threshold after their deadline
+  uint64_t missed;          ///< Deadlines skipped because the loop was busy
+  uint64_t min_ns;          ///< Lateness of the runs
+  uint64_t max_ns;
+  double mean_ns;
+  double stddev_ns;
+} ina219_sched_stats_t;
+
+class Adafruit_INA219_Scheduler{
+ public:
+  Adafruit_INA219_Scheduler(void);
+  ~Adafruit_INA219_Scheduler(void);
+  bool begin(void);
+  int add(uint32_t period_us, ina219_task_t fn, void *arg);
+  void setLateThreshold_us(uint32_t late_us);
+  int run(void);
+  int runOnce(int timeout_ms);
+  void stop(void);
+  void getStats(int id, ina219_sched_stats_t *stats);
+  void resetStats(void);
+  void end(void);
+
+  static bool setRealtime(int priority, int cpu, bool lockMemory);
+  static uint64_t now_ns(void);
+
+ private:
+  struct task {
+    ina219_task_t fn;
+    void *arg;
+    uint8_t period;
+    uint64_t runs, late, missed, min_ns, max_ns;
+    double mean_ns, m2;     // Welford
+  };
+  struct period {
+    int fd;
+    uint32_t period_us;
+    uint64_t next_ns;       // deadline of the next expiration
+  };
+
+  task sched_tasks[INA219_SCHED_MAX_TASKS];
+  period sched_periods[INA219_SCHED_MAX_PERIODS];
+  int sched_taskCount;
+  int sched_periodCount;
+  int sched_epoll;
+  int sched_stopFd;
+  uint64_t sched_late_ns;
+  uint64_t sched_start_ns;
+  volatile bool sched_running;
+
+  void expire(period *p, int index);
+};
+
+#endif
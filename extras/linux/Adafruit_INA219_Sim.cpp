@@ -0,0 +1,416 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Sim.cpp
+	@license  BSD (see license.txt)
+
+	Simulated I2C bus with INA219 chips behind the Linux Wire shim
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <time.h>
+
+#include "Adafruit_INA219_Sim.h"
+
+/**************************************************************************/
+/*! 
+    @brief  Returns CLOCK_MONOTONIC in ns, for the bus timing
+*/
+/**************************************************************************/
+static uint64_t monotonic_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates an empty bus at 100kHz, with no bus timing
+*/
+/**************************************************************************/
+Adafruit_INA219_Sim::Adafruit_INA219_Sim() {
+  sim_count = 0;
+  sim_clock_Hz = 100000;
+  sim_timeout_us = 25000;
+  sim_jitter_us = 0;
+  sim_random = 1;
+  sim_timing = false;
+  sim_virtual = false;
+  sim_fault = INA219_SIM_FAULT_NONE;
+  sim_faultCount = 0;
+  sim_faultAfter = 0;
+  sim_transactions = 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Adds a chip at 'addr', in its power-on state (continuous
+            shunt and bus conversions, no calibration).  Returns false
+            if the bus is full or the address taken.
+*/
+/**************************************************************************/
+bool Adafruit_INA219_Sim::addDevice(uint8_t addr) {
+  if (sim_count >= INA219_SIM_MAX_DEVICES || find(addr) != NULL)
+    return false;
+
+  ina219_sim_device_t *dev = &sim_devices[sim_count++];
+  memset(dev, 0, sizeof(*dev));
+  dev->addr = addr;
+  writeRegister(dev, 0, INA219_SIM_CONFIG_RESET);
+  return true;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sets the voltages the chip at 'addr' measures from its next
+            conversion on
+*/
+/**************************************************************************/
+void Adafruit_INA219_Sim::setInput(uint8_t addr, int32_t shunt_uV, int32_t bus_mV) {
+  ina219_sim_device_t *dev = find(addr);
+  if (dev == NULL)
+    return;
+  // conversions completed before now saw the previous input
+  update(dev);
+  dev->shunt_uV = shunt_uV;
+  dev->bus_mV = bus_mV;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Makes each conversion last its nominal time +- a uniformly
+            distributed 'jitter_us', standing for the chip's internal
+            oscillator
+*/
+/**************************************************************************/
+void Adafruit_INA219_Sim::setConversionJitter_us(uint32_t jitter_us) {
+  sim_jitter_us = jitter_us;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  When enabled each transfer takes the time of its SCL periods
+            at the clock set through Wire.setClock()
+*/
+/**************************************************************************/
+void Adafruit_INA219_Sim::setBusTiming(bool enable) {
+  sim_timing = enable;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Runs the driver and the chips on the virtual clock of the
+            Arduino shim.  Each transfer then advances it by its bus
+            time, or by INA219_SIM_TRANSFER_NS without bus timing.
+*/
+/**************************************************************************/
+void Adafruit_INA219_Sim::setVirtualTime(bool enable) {
+  sim_virtual = enable;
+  ::setVirtualTime(enable);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Makes 'count' transfers fail with 'fault'
+            (INA219_SIM_FAULT_*) after letting 'after' transfers
+            through
+*/
+/**************************************************************************/
+void Adafruit_INA219_Sim::injectFault(uint8_t fault, uint16_t count, uint16_t after) {
+  sim_fault = fault;
+  sim_faultCount = count;
+  sim_faultAfter = after;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the number of transfers seen, failed ones included
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Sim::getTransactions() {
+  return sim_transactions;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the number of transfers addressed to the chip at
+            'addr', i.e. without HS master codes and bus scans
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Sim::getTransactions(uint8_t addr) {
+  ina219_sim_device_t *dev = find(addr);
+  return (dev == NULL) ? 0 : dev->transactions;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the number of conversions the chip at 'addr' has
+            completed
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Sim::getConversions(uint8_t addr) {
+  ina219_sim_device_t *dev = find(addr);
+  if (dev == NULL)
+    return 0;
+  update(dev);
+  return dev->conversions;
+}
+
+void Adafruit_INA219_Sim::setClock(uint32_t clock_Hz) {
+  sim_clock_Hz = clock_Hz;
+}
+
+void Adafruit_INA219_Sim::setTimeout_us(uint32_t timeout_us) {
+  sim_timeout_us = timeout_us;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Writes 'len' bytes: the register pointer, then optionally a
+            16-bit value.  Returns a Wire endTransmission() code.
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219_Sim::write(uint8_t addr, const uint8_t *data, uint8_t len) {
+  uint8_t fault = transaction(len);
+  ina219_sim_device_t *dev = find(addr);
+
+  if (dev != NULL)
+    dev->transactions++;
+  if (fault == INA219_SIM_FAULT_STUCK)
+    return 5;
+  if (fault == INA219_SIM_FAULT_NACK || dev == NULL)
+    return 2;
+  if (fault == INA219_SIM_FAULT_SHORT)
+    return 3;
+
+  if (len >= 1)
+    dev->pointer = data[0];
+  if (len >= 3)
+    writeRegister(dev, data[0], (data[1] << 8) | data[2]);
+  return 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads the register the pointer is set to, MSB first.
+            Returns the number of bytes read, and the Wire
+            endTransmission() code of the transfer in 'status'.
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219_Sim::read(uint8_t addr, uint8_t *data, uint8_t len, uint8_t *status) {
+  uint8_t fault = transaction(len);
+  ina219_sim_device_t *dev = find(addr);
+
+  if (dev != NULL)
+    dev->transactions++;
+  *status = 0;
+  if (fault == INA219_SIM_FAULT_STUCK) {
+    *status = 5;
+    return 0;
+  }
+  if (fault == INA219_SIM_FAULT_NACK || dev == NULL) {
+    *status = 2;
+    return 0;
+  }
+
+  uint16_t value = readRegister(dev, dev->pointer);
+  for (uint8_t i = 0; i < len; i++)
+    data[i] = (i == 0) ? value >> 8 : (i == 1) ? value & 0xFF : 0xFF;
+  if (fault == INA219_SIM_FAULT_SHORT && len > 1)
+    return 1;
+  return len;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Accounts for one transfer of 'bytes' data bytes: picks the
+            fault to apply, if any, and waits for its bus time
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA219_Sim::transaction(uint8_t bytes) {
+  uint8_t fault = INA219_SIM_FAULT_NONE;
+
+  sim_transactions++;
+  if (sim_faultCount) {
+    if (sim_faultAfter) {
+      sim_faultAfter--;
+    } else {
+      fault = sim_fault;
+      sim_faultCount--;
+    }
+  }
+
+  if (fault == INA219_SIM_FAULT_STUCK) {
+    // the master gives up at its timeout
+    busTime((uint64_t)sim_timeout_us * 1000);
+  } else if (sim_timing) {
+    // START, address and data bytes with their ACK, STOP
+    uint32_t periods = 9 * (bytes + 1) + 2;
+    busTime((uint64_t)periods * 1000000000 / sim_clock_Hz);
+  } else if (sim_virtual) {
+    busTime(INA219_SIM_TRANSFER_NS);
+  }
+  return fault;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Lets 'time_ns' pass on the bus: advances the virtual clock,
+            or spins since sleeping would be far too coarse
+*/
+/**************************************************************************/
+void Adafruit_INA219_Sim::busTime(uint64_t time_ns) {
+  if (sim_virtual) {
+    advanceTime_ns(time_ns);
+    return;
+  }
+  uint64_t end = monotonic_ns() + time_ns;
+  while (monotonic_ns() < end)
+    ;
+}
+
+ina219_sim_device_t *Adafruit_INA219_Sim::find(uint8_t addr) {
+  for (uint8_t i = 0; i < sim_count; i++)
+    if (sim_devices[i].addr == addr)
+      return &sim_devices[i];
+  return NULL;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns the nominal time of a conversion cycle of the chip,
+            as in the datasheet: 84-532us per 9 to 12-bit sample, 532us
+            per averaged sample
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA219_Sim::conversionTime_us(ina219_sim_device_t *dev) {
+  uint32_t time_us = 0;
+  uint8_t mode = dev->config & 0x7;
+  uint8_t adc[2] = { (uint8_t)((dev->config >> 3) & 0xF), (uint8_t)((dev->config >> 7) & 0xF) };
+
+  for (uint8_t i = 0; i < 2; i++) {
+    if (!(mode & (1 << i)))
+      continue;
+    if (adc[i] & 0x08)
+      time_us += 532UL << (adc[i] & 0x07);
+    else
+      time_us += 20 + (64UL << (adc[i] & 0x03));
+  }
+  return time_us;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Starts a conversion cycle at 'now'
+*/
+/**************************************************************************/
+void Adafruit_INA219_Sim::startConversion(ina219_sim_device_t *dev, uint32_t now) {
+  int32_t jitter = 0;
+
+  if (sim_jitter_us) {
+    sim_random = sim_random * 1103515245 + 12345;
+    jitter = (int32_t)((sim_random >> 8) % (2 * sim_jitter_us + 1)) - (int32_t)sim_jitter_us;
+  }
+  dev->running = true;
+  dev->next_us = now + conversionTime_us(dev) + jitter;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Completes the conversions due by now, latching the input
+            into the result registers and setting CNVR
+*/
+/**************************************************************************/
+void Adafruit_INA219_Sim::update(ina219_sim_device_t *dev) {
+  uint32_t now = micros();
+
+  while (dev->running && (int32_t)(now - dev->next_us) >= 0) {
+    uint8_t mode = dev->config & 0x7;
+
+    if (mode & 0x1) {
+      // saturates at the PGA full scale, 40mV x gain
+      int32_t limit = 4000L << ((dev->config >> 11) & 0x3);
+      int32_t shunt = dev->shunt_uV / 10;
+      dev->shunt = (shunt > limit) ? limit : (shunt < -limit) ? -limit : shunt;
+    }
+    if (mode & 0x2) {
+      int32_t bus = dev->bus_mV / 4;
+      dev->bus = (bus < 0) ? 0 : (bus > 8000) ? 8000 : bus;
+    }
+    dev->cnvr = true;
+    dev->conversions++;
+
+    uint32_t done = dev->next_us;
+    if (mode & 0x4)
+      startConversion(dev, done);
+    else
+      dev->running = false;
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads a register.  CURRENT and POWER are computed from the
+            last conversion with the calibration in place, and reading
+            POWER clears CNVR.
+*/
+/**************************************************************************/
+uint16_t Adafruit_INA219_Sim::readRegister(ina219_sim_device_t *dev, uint8_t reg) {
+  update(dev);
+
+  int32_t current = (int32_t)dev->shunt * dev->cal / 4096;
+  int32_t power = (current < 0 ? -current : current) * (int32_t)dev->bus / 5000;
+  bool ovf = current > 32767 || current < -32768 || power > 65535;
+
+  switch (reg) {
+    case 0:
+      return dev->config;
+    case 1:
+      return (uint16_t)dev->shunt;
+    case 2:
+      return (dev->bus << 3) | (dev->cnvr ? 0x2 : 0) | (ovf ? 0x1 : 0);
+    case 3:
+      dev->cnvr = false;
+      return (uint16_t)power;
+    case 4:
+      return (uint16_t)current;
+    case 5:
+      return dev->cal;
+    default:
+      return 0;
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Writes a register.  A config write clears CNVR and restarts
+            the conversions, or starts one in the triggered modes.
+*/
+/**************************************************************************/
+void Adafruit_INA219_Sim::writeRegister(ina219_sim_device_t *dev, uint8_t reg, uint16_t value) {
+  update(dev);
+
+  if (reg == 5) {
+    // bit 0 is read-only 0
+    dev->cal = value & 0xFFFE;
+    return;
+  }
+  if (reg != 0)
+    return;
+
+  if (value & INA219_SIM_CONFIG_RESET) {
+    value = INA219_SIM_CONFIG_DEFAULT;
+    dev->cal = 0;
+  }
+  dev->config = value;
+  dev->cnvr = false;
+
+  uint8_t mode = value & 0x7;
+  if (mode == 0 || mode == 4)
+    dev->running = false;
+  else
+    startConversion(dev, micros());
+}
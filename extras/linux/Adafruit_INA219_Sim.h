@@ -0,0 +1,104 @@
+/**************************************************************************/
+/*! 
+    @file     Adafruit_INA219_Sim.h
+	@license  BSD (see license.txt)
+
+	Simulated I2C bus with INA219 chips behind the Linux Wire shim, to
+	run the unchanged driver without hardware
+
+	Each chip has the register file, conversion timing (continuous and
+	triggered modes, CNVR/OVF), the CURRENT/POWER math of the real
+	part and an input set by the caller.  Transfers can take the time
+	their SCL periods would take at the selected clock, and faults
+	(NACK, short read, stuck bus) can be injected to test the driver's
+	error handling.
+
+	With virtual time (setVirtualTime()) the chips and the driver run
+	on a clock that only transfers and delays advance, so timing tests
+	give the same result on a loaded host.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _ADAFRUIT_INA219_SIM_H_
+#define _ADAFRUIT_INA219_SIM_H_
+
+#include "Arduino.h"
+
+/*=========================================================================
+    SIMULATED BUS
+    -----------------------------------------------------------------------*/
+    #define INA219_SIM_MAX_DEVICES                 (8)
+    #define INA219_SIM_TRANSFER_NS                 (1000)    // Virtual transfer time without bus timing
+    /*---------------------------------------------------------------------*/
+    #define INA219_SIM_FAULT_NONE                  (0)
+    #define INA219_SIM_FAULT_NACK                  (1)       // Address not acknowledged
+    #define INA219_SIM_FAULT_SHORT                 (2)       // Read ends after one byte
+    #define INA219_SIM_FAULT_STUCK                 (3)       // SDA held low until the Wire timeout
+    /*---------------------------------------------------------------------*/
+    #define INA219_SIM_CONFIG_RESET                (0x8000)
+    #define INA219_SIM_CONFIG_DEFAULT              (0x399F)  // Power-on config
+/*=========================================================================*/
+
+typedef struct {
+  uint8_t addr;
+  uint16_t config;
+  uint16_t cal;
+  uint8_t pointer;
+  int32_t shunt_uV;             ///< Input, across the shunt
+  int32_t bus_mV;               ///< Input, IN- to GND
+  int16_t shunt;                ///< Last conversion, shunt register
+  uint16_t bus;                 ///< Last conversion, bus voltage in 4mV
+  bool cnvr;
+  bool running;                 ///< A conversion is in progress
+  uint32_t next_us;             ///< When it completes
+  uint32_t conversions;
+  uint32_t transactions;         ///< Transfers addressed to it
+} ina219_sim_device_t;
+
+class Adafruit_INA219_Sim{
+ public:
+  Adafruit_INA219_Sim(void);
+  bool addDevice(uint8_t addr);
+  void setInput(uint8_t addr, int32_t shunt_uV, int32_t bus_mV);
+  void setConversionJitter_us(uint32_t jitter_us);
+  void setBusTiming(bool enable);
+  void setVirtualTime(bool enable);
+  void injectFault(uint8_t fault, uint16_t count = 1, uint16_t after = 0);
+  uint32_t getTransactions(void);
+  uint32_t getTransactions(uint8_t addr);
+  uint32_t getConversions(uint8_t addr);
+  // called by the Wire shim
+  void setClock(uint32_t clock_Hz);
+  void setTimeout_us(uint32_t timeout_us);
+  uint8_t write(uint8_t addr, const uint8_t *data, uint8_t len);
+  uint8_t read(uint8_t addr, uint8_t *data, uint8_t len, uint8_t *status);
+
+ private:
+  ina219_sim_device_t sim_devices[INA219_SIM_MAX_DEVICES];
+  uint8_t sim_count;
+  uint32_t sim_clock_Hz;
+  uint32_t sim_timeout_us;
+  uint32_t sim_jitter_us;
+  uint32_t sim_random;
+  bool sim_timing;
+  bool sim_virtual;
+  uint8_t sim_fault;
+  uint16_t sim_faultCount;
+  uint16_t sim_faultAfter;
+  uint32_t sim_transactions;
+
+  ina219_sim_device_t *find(uint8_t addr);
+  uint8_t transaction(uint8_t bytes);
+  void busTime(uint64_t time_ns);
+  uint32_t conversionTime_us(ina219_sim_device_t *dev);
+  void update(ina219_sim_device_t *dev);
+  void startConversion(ina219_sim_device_t *dev, uint32_t now);
+  uint16_t readRegister(ina219_sim_device_t *dev, uint8_t reg);
+  void writeRegister(ina219_sim_device_t *dev, uint8_t reg, uint16_t value);
+};
+
+#endif
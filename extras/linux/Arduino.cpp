@@ -0,0 +1,97 @@
+/**************************************************************************/
+/*! 
+    @file     Arduino.cpp
+	@license  BSD (see license.txt)
+	
+	Minimal Arduino core for building the INA219 driver on Linux hosts
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <time.h>
+#include <errno.h>
+
+#include "Arduino.h"
+
+static bool virtualTime = false;
+static uint64_t virtual_ns = 0;
+
+/**************************************************************************/
+/*! 
+    @brief  Returns CLOCK_MONOTONIC in us, wrapping at 32 bits like
+            micros() does on a board
+*/
+/**************************************************************************/
+static uint64_t monotonic_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+unsigned long millis(void)
+{
+  if (virtualTime)
+    return (uint32_t)(virtual_ns / 1000000);
+  return (uint32_t)(monotonic_us() / 1000);
+}
+
+unsigned long micros(void)
+{
+  if (virtualTime)
+    return (uint32_t)(virtual_ns / 1000);
+  return (uint32_t)monotonic_us();
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Switches millis(), micros() and the delays to the virtual
+            clock, which starts where the real one is, or back
+*/
+/**************************************************************************/
+void setVirtualTime(bool enable)
+{
+  if (enable && !virtualTime)
+    virtual_ns = monotonic_us() * 1000;
+  virtualTime = enable;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Moves the virtual clock forward, e.g. by a transfer's bus time
+*/
+/**************************************************************************/
+void advanceTime_ns(uint64_t time_ns)
+{
+  virtual_ns += time_ns;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sleeps for 'us', restarting after signals
+*/
+/**************************************************************************/
+static void sleep_us(uint64_t us)
+{
+  if (virtualTime) {
+    virtual_ns += us * 1000;
+    return;
+  }
+  struct timespec ts;
+  ts.tv_sec = us / 1000000;
+  ts.tv_nsec = (us % 1000000) * 1000;
+  while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+    ;
+}
+
+void delay(unsigned long ms)
+{
+  sleep_us((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+  sleep_us(us);
+}
@@ -0,0 +1,33 @@
+/**************************************************************************/
+/*! 
+    @file     Arduino.h
+	@license  BSD (see license.txt)
+	
+	Minimal Arduino core for building the INA219 driver on Linux hosts,
+	just what Adafruit_INA219.cpp needs: timing and the integer types
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _INA219_LINUX_ARDUINO_H_
+#define _INA219_LINUX_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis(void);
+unsigned long micros(void);
+
+// host only: a virtual clock for the simulated bus (Adafruit_INA219_Sim),
+// while enabled millis() and micros() return it and delays advance it
+void setVirtualTime(bool enable);
+void advanceTime_ns(uint64_t time_ns);
+
+#endif
@@ -0,0 +1,240 @@
+/**************************************************************************/
+/*! 
+    @file     Wire.cpp
+	@license  BSD (see license.txt)
+	
+	Wire (TwoWire) on top of the Linux i2c-dev interface
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "Wire.h"
+#include "Adafruit_INA219_Sim.h"
+
+TwoWire Wire;
+
+/**************************************************************************/
+/*! 
+    @brief  Instantiates a bus on the given i2c-dev device
+*/
+/**************************************************************************/
+TwoWire::TwoWire(const char *device) {
+  wire_device = device;
+  wire_fd = -1;
+  wire_sim = NULL;
+  wire_addr = 0;
+  wire_txLength = 0;
+  wire_txPending = false;
+  wire_rxLength = 0;
+  wire_rxIndex = 0;
+  wire_timeoutFlag = false;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Changes the i2c-dev device, call it before begin()
+*/
+/**************************************************************************/
+void TwoWire::setDevice(const char *device) {
+  end();
+  wire_device = device;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sends the transfers to a simulated bus ('sim' not NULL) or
+            back to the i2c-dev device (NULL)
+*/
+/**************************************************************************/
+void TwoWire::setSimulator(Adafruit_INA219_Sim *sim) {
+  wire_sim = sim;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Opens the device, returns false if it can't be opened.  Like
+            on a board, calling it again is harmless.
+*/
+/**************************************************************************/
+bool TwoWire::begin() {
+  if (wire_sim != NULL)
+    return true;
+  if (wire_fd < 0)
+    wire_fd = open(wire_device, O_RDWR | O_CLOEXEC);
+  return wire_fd >= 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Closes the device
+*/
+/**************************************************************************/
+void TwoWire::end() {
+  if (wire_fd >= 0)
+    close(wire_fd);
+  wire_fd = -1;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  The bus clock of a Linux adapter is set by its driver (device
+            tree, module parameter), it can't be changed from here
+*/
+/**************************************************************************/
+void TwoWire::setClock(uint32_t clock_Hz) {
+  if (wire_sim != NULL)
+    wire_sim->setClock(clock_Hz);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sets the adapter timeout, the kernel counts it in 10ms units
+*/
+/**************************************************************************/
+void TwoWire::setWireTimeout(uint32_t timeout_us, bool reset_on_timeout) {
+  (void)reset_on_timeout;
+  if (wire_sim != NULL)
+    wire_sim->setTimeout_us(timeout_us);
+  else if (wire_fd >= 0)
+    ioctl(wire_fd, I2C_TIMEOUT, (unsigned long)((timeout_us + 9999) / 10000));
+}
+
+bool TwoWire::getWireTimeoutFlag() {
+  return wire_timeoutFlag;
+}
+
+void TwoWire::clearWireTimeoutFlag() {
+  wire_timeoutFlag = false;
+}
+
+void TwoWire::beginTransmission(uint8_t addr) {
+  wire_addr = addr;
+  wire_txLength = 0;
+  wire_txPending = false;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (wire_txLength >= WIRE_BUFFER_LENGTH)
+    return 0;
+  wire_txBuffer[wire_txLength++] = data;
+  return 1;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Maps an i2c-dev result to the Wire endTransmission() codes:
+            0 ok, 2 address NACK, 4 other error, 5 timeout
+*/
+/**************************************************************************/
+uint8_t TwoWire::transferStatus(int result) {
+  if (result >= 0)
+    return 0;
+  switch (errno) {
+    case ENXIO:
+    case EREMOTEIO:
+      return 2;
+    case ETIMEDOUT:
+      wire_timeoutFlag = true;
+      return 5;
+    default:
+      return 4;
+  }
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Sends the buffered bytes.  Without STOP they are kept and go
+            out with the next requestFrom() as a combined transfer.
+*/
+/**************************************************************************/
+uint8_t TwoWire::endTransmission(bool stop) {
+  if (wire_sim != NULL) {
+    // a repeated start takes as long as STOP and START on the bus
+    uint8_t status = wire_sim->write(wire_addr, wire_txBuffer, wire_txLength);
+    if (status == 5)
+      wire_timeoutFlag = true;
+    return status;
+  }
+  if (wire_fd < 0)
+    return 4;
+  if (!stop) {
+    wire_txPending = true;
+    return 0;
+  }
+
+  struct i2c_msg msg;
+  struct i2c_rdwr_ioctl_data xfer;
+  msg.addr = wire_addr;
+  msg.flags = 0;
+  msg.len = wire_txLength;
+  msg.buf = wire_txBuffer;
+  xfer.msgs = &msg;
+  xfer.nmsgs = 1;
+  return transferStatus(ioctl(wire_fd, I2C_RDWR, &xfer));
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Reads 'len' bytes, returns the number of bytes read (0 on
+            error, the kernel doesn't report partial reads)
+*/
+/**************************************************************************/
+uint8_t TwoWire::requestFrom(uint8_t addr, uint8_t len) {
+  struct i2c_msg msgs[2];
+  struct i2c_rdwr_ioctl_data xfer;
+  uint8_t n = 0;
+
+  wire_rxLength = 0;
+  wire_rxIndex = 0;
+  if (len > WIRE_BUFFER_LENGTH)
+    len = WIRE_BUFFER_LENGTH;
+  if (wire_sim != NULL) {
+    uint8_t status;
+    wire_rxLength = wire_sim->read(addr, wire_rxBuffer, len, &status);
+    if (status == 5)
+      wire_timeoutFlag = true;
+    return wire_rxLength;
+  }
+  if (wire_fd < 0)
+    return 0;
+
+  if (wire_txPending && wire_addr == addr) {
+    msgs[n].addr = addr;
+    msgs[n].flags = 0;
+    msgs[n].len = wire_txLength;
+    msgs[n].buf = wire_txBuffer;
+    n++;
+  }
+  wire_txPending = false;
+  msgs[n].addr = addr;
+  msgs[n].flags = I2C_M_RD;
+  msgs[n].len = len;
+  msgs[n].buf = wire_rxBuffer;
+  n++;
+
+  xfer.msgs = msgs;
+  xfer.nmsgs = n;
+  if (transferStatus(ioctl(wire_fd, I2C_RDWR, &xfer)) != 0)
+    return 0;
+  wire_rxLength = len;
+  return len;
+}
+
+int TwoWire::available() {
+  return wire_rxLength - wire_rxIndex;
+}
+
+int TwoWire::read() {
+  if (wire_rxIndex >= wire_rxLength)
+    return -1;
+  return wire_rxBuffer[wire_rxIndex++];
+}
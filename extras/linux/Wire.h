@@ -0,0 +1,65 @@
+/**************************************************************************/
+/*! 
+    @file     Wire.h
+	@license  BSD (see license.txt)
+	
+	Wire (TwoWire) on top of the Linux i2c-dev interface, so the INA219
+	driver runs unchanged on Linux hosts.  A write ended without STOP
+	(endTransmission(false)) is combined with the following
+	requestFrom() into one I2C_RDWR transfer with a repeated start.
+	setSimulator() routes the transfers to an Adafruit_INA219_Sim
+	instead.
+
+	@section  HISTORY
+
+    v1.0  - First release
+*/
+/**************************************************************************/
+
+#ifndef _INA219_LINUX_WIRE_H_
+#define _INA219_LINUX_WIRE_H_
+
+#include "Arduino.h"
+
+#define WIRE_HAS_TIMEOUT                           // setWireTimeout() and co.
+#define WIRE_BUFFER_LENGTH                        (32)
+
+class Adafruit_INA219_Sim;
+
+class TwoWire{
+ public:
+  TwoWire(const char *device = "/dev/i2c-1");
+  void setDevice(const char *device);
+  void setSimulator(Adafruit_INA219_Sim *sim);
+  bool begin(void);
+  void end(void);
+  void setClock(uint32_t clock_Hz);
+  void setWireTimeout(uint32_t timeout_us = 25000, bool reset_on_timeout = false);
+  bool getWireTimeoutFlag(void);
+  void clearWireTimeoutFlag(void);
+  void beginTransmission(uint8_t addr);
+  size_t write(uint8_t data);
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(uint8_t addr, uint8_t len);
+  int available(void);
+  int read(void);
+
+ private:
+  const char *wire_device;
+  int wire_fd;
+  Adafruit_INA219_Sim *wire_sim;
+  uint8_t wire_addr;
+  uint8_t wire_txBuffer[WIRE_BUFFER_LENGTH];
+  uint8_t wire_txLength;
+  bool wire_txPending;          // written without STOP, sent with the read
+  uint8_t wire_rxBuffer[WIRE_BUFFER_LENGTH];
+  uint8_t wire_rxLength;
+  uint8_t wire_rxIndex;
+  bool wire_timeoutFlag;
+
+  uint8_t transferStatus(int result);
+};
+
+extern TwoWire Wire;
+
+#endif
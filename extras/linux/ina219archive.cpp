@@ -0,0 +1,209 @@
+/**************************************************************************/
+/*! 
+    @file     ina219archive.cpp
+	@license  BSD (see license.txt)
+	
+	Imports an ina219d log into a block archive, and queries it
+
+	  ina219archive -i log_file archive
+	      appends the records of the log to the archive
+	  ina219archive -q sensor [-f from_s] [-t to_s] [-r] archive
+	      prints the aggregate of a sensor over a time range (seconds
+	      since the epoch), or with -r its records as CSV
+	  ina219archive -c log_file archive
+	      checks that the archive, imported from the log alone, gives
+	      back every record of the log with its time rounded to
+	      INA219_ARCHIVE_RESOLUTION_NS; exits with 1 if not
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Adafruit_INA219_Archive.h"
+#include "Adafruit_INA219_Log.h"
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s -i log_file archive\n"
+          "       %s -q sensor [-f from_s] [-t to_s] [-r] archive\n"
+          "       %s -c log_file archive\n", name, name, name);
+  exit(1);
+}
+
+static int import(const char *logPath, const char *path)
+{
+  Adafruit_INA219_Log log;
+  Adafruit_INA219_Archive archive;
+
+  if (!log.open(logPath, INA219_LOG_DEFAULT_SLOTS, true)) {
+    perror(logPath);
+    return 1;
+  }
+  if (!archive.open(path, true)) {
+    perror(path);
+    return 1;
+  }
+  const ina219_log_header_t *header = log.header();
+  for (uint32_t i = 0; i < header->sensors && i < INA219_RING_MAX_SENSORS; i++)
+    archive.setSensor(i, header->sensor[i].address, header->sensor[i].currentLsb_mA);
+
+  uint64_t imported = 0;
+  ina219_record_t record;
+  for (uint64_t seq = log.oldest(); seq != 0 && seq <= log.head(); seq++)
+    if (log.read(seq, &record) && archive.append(&record))
+      imported++;
+  if (!archive.flush()) {
+    perror(path);
+    return 1;
+  }
+  fprintf(stderr, "ina219archive: %llu records imported\n", (unsigned long long)imported);
+  return 0;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Compares every record of the log with the archive, sensor
+            by sensor in log order, and prints the first difference
+*/
+/**************************************************************************/
+static int verify(const char *logPath, const char *path)
+{
+  Adafruit_INA219_Log log;
+  Adafruit_INA219_Archive archive;
+
+  if (!log.open(logPath, INA219_LOG_DEFAULT_SLOTS, true)) {
+    perror(logPath);
+    return 1;
+  }
+  if (!archive.open(path)) {
+    perror(path);
+    return 1;
+  }
+
+  uint64_t checked = 0, bad = 0;
+  for (int sensor = 0; sensor < INA219_RING_MAX_SENSORS; sensor++) {
+    const ina219_block_t *blocks;
+    uint32_t found = archive.find(sensor, 0, UINT64_MAX, &blocks);
+    uint64_t held = 0;
+    for (uint32_t b = 0; b < found; b++)
+      held += blocks[b].summary.count;
+
+    ina219_record_t *archived = (ina219_record_t *)malloc((held + 1) * sizeof(*archived));
+    if (archived == NULL) {
+      perror("ina219archive");
+      return 1;
+    }
+    uint32_t n = archive.read(sensor, 0, UINT64_MAX, archived, held);
+
+    uint32_t i = 0;
+    ina219_record_t record;
+    for (uint64_t seq = log.oldest(); seq != 0 && seq <= log.head(); seq++) {
+      if (!log.read(seq, &record) || record.sensor != sensor)
+        continue;
+      record.time_ns = (record.time_ns + INA219_ARCHIVE_RESOLUTION_NS / 2) /
+                       INA219_ARCHIVE_RESOLUTION_NS * INA219_ARCHIVE_RESOLUTION_NS;
+      if (i >= n) {
+        if (bad++ == 0)
+          fprintf(stderr, "ina219archive: log record %llu missing\n", (unsigned long long)seq);
+      } else {
+        const ina219_record_t *a = &archived[i];
+        if ((a->time_ns != record.time_ns || a->address != record.address ||
+             a->flags != record.flags || a->status != record.status ||
+             a->shunt != record.shunt || a->bus != record.bus ||
+             a->current != record.current || a->power != record.power) && bad++ == 0)
+          fprintf(stderr, "ina219archive: log record %llu differs\n", (unsigned long long)seq);
+      }
+      i++;
+      checked++;
+    }
+    if (i < n && bad++ == 0)
+      fprintf(stderr, "ina219archive: sensor %d: %u records not in the log\n", sensor, n - i);
+    free(archived);
+  }
+
+  fprintf(stderr, "ina219archive: %llu records checked, %s\n", (unsigned long long)checked,
+          bad ? "FAILED" : "ok");
+  return bad ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+  const char *logPath = NULL;
+  bool check = false;
+  int sensor = -1;
+  double from_s = 0, to_s = 0;
+  bool records = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "i:c:q:f:t:r")) != -1) {
+    switch (opt) {
+      case 'i': logPath = optarg; break;
+      case 'c': logPath = optarg; check = true; break;
+      case 'q': sensor = atoi(optarg); break;
+      case 'f': from_s = atof(optarg); break;
+      case 't': to_s = atof(optarg); break;
+      case 'r': records = true; break;
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (optind >= argc || (logPath == NULL) == (sensor < 0))
+    usage(argv[0]);
+  if (logPath != NULL)
+    return check ? verify(logPath, argv[optind]) : import(logPath, argv[optind]);
+
+  Adafruit_INA219_Archive archive;
+  if (!archive.open(argv[optind])) {
+    perror(argv[optind]);
+    return 1;
+  }
+  uint64_t from_ns = (uint64_t)(from_s * 1e9);
+  uint64_t to_ns = (to_s > 0) ? (uint64_t)(to_s * 1e9) : UINT64_MAX;
+  const ina219_block_t *blocks;
+  uint32_t found = archive.find(sensor, from_ns, to_ns, &blocks);
+
+  if (records) {
+    ina219_record_t *out = (ina219_record_t *)malloc(INA219_ARCHIVE_BLOCK_RECORDS * sizeof(*out));
+    printf("time_ns,address,shunt_mV,bus_V,current_mA,power_mW,flags,status\n");
+    for (uint32_t b = 0; b < found; b++) {
+      uint64_t first = blocks[b].summary.first_ns, last = blocks[b].summary.last_ns + 1;
+      uint32_t n = archive.read(sensor, first > from_ns ? first : from_ns,
+                                last < to_ns ? last : to_ns, out, INA219_ARCHIVE_BLOCK_RECORDS);
+      float lsb = blocks[b].summary.currentLsb_mA;
+      for (uint32_t i = 0; i < n; i++)
+        printf("%llu,0x%02x,%.2f,%.3f,%.3f,%.3f,%u,%u\n",
+               (unsigned long long)out[i].time_ns, out[i].address, out[i].shunt * 0.01,
+               out[i].bus * 0.001, out[i].current * lsb, out[i].power * lsb / 1000,
+               out[i].flags, out[i].status);
+    }
+    free(out);
+    return 0;
+  }
+
+  ina219_summary_t s;
+  if (!archive.aggregate(sensor, from_ns, to_ns, &s)) {
+    fprintf(stderr, "ina219archive: no records\n");
+    return 1;
+  }
+  float lsb = s.currentLsb_mA;
+  printf("records      %u (%u good) from %.6f to %.6f\n", s.count, s.good,
+         s.first_ns / 1e9, s.last_ns / 1e9);
+  if (s.good == 0)
+    return 0;
+  printf("current_mA   min %.3f mean %.3f max %.3f\n", s.current_min * lsb,
+         (double)s.current_sum / s.good * lsb, s.current_max * lsb);
+  printf("bus_V        min %.3f mean %.3f max %.3f\n", s.bus_min * 0.001,
+         (double)s.bus_sum / s.good * 0.001, s.bus_max * 0.001);
+  printf("power_mW     min %.3f max %.3f\n", s.power_min * lsb / 1000, s.power_max * lsb / 1000);
+  printf("energy_J     %.6f\n", s.energy_J);
+  printf("blocks       %u in range of %u, %u decoded\n", found, archive.getBlocks(sensor),
+         archive.getDecodedBlocks());
+  return 0;
+}
@@ -0,0 +1,133 @@
+/**************************************************************************/
+/*!
+    @file     ina219bench.cpp
+	@license  BSD (see license.txt)
+
+	Benchmark of the driver's bus traffic on the simulated bus: register
+	reads, register writes and full samples per second at each SCL
+	clock, with transfers taking the time of their SCL periods (START,
+	address and data bytes with their ACK, STOP).  By default the time
+	is virtual, so the figures are the bus time of what the driver
+	actually sends; with -r the simulator spins for real, which adds
+	the driver's and the shims' CPU time.
+
+	Usage: ina219bench [-n operations] [-r]
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "Adafruit_INA219.h"
+#include "Adafruit_INA219_Sim.h"
+
+static const struct {
+  const char *name;
+  uint32_t clock_Hz;
+} clocks[] = {
+  { "100kHz", INA219_I2C_CLOCK_STANDARD },
+  { "400kHz", INA219_I2C_CLOCK_FAST },
+  { "2.56MHz (HS)", INA219_I2C_CLOCK_HIGHSPEED },
+};
+
+#define OP_READ         (0)     // shunt and bus voltage in turn
+#define OP_WRITE        (1)     // calibration and config writes
+#define OP_SAMPLE       (2)     // getSample(), CURRENT/POWER registers
+#define OP_SAMPLE_SW    (3)     // getSample(), software power
+#define OPS             (4)
+
+/**************************************************************************/
+/*!
+    @brief  Runs 'n' operations of kind 'op', returns them per second
+            and the transactions with the chip each took (HS master
+            codes aside) in '*transactions'
+*/
+/**************************************************************************/
+static double run(Adafruit_INA219 *ina219, Adafruit_INA219_Sim *sim, int op, uint32_t n,
+                  double *transactions)
+{
+  ina219_sample_t sample;
+  uint32_t count = 0;
+
+  ina219->setSoftwarePower(op == OP_SAMPLE_SW);
+  ina219->getBusVoltage_raw();
+  uint32_t before = sim->getTransactions(INA219_ADDRESS);
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < n; i++) {
+    switch (op) {
+      case OP_READ:
+        ina219->getShuntVoltage_raw();
+        ina219->getBusVoltage_raw();
+        count += 2;
+        break;
+      case OP_WRITE:
+        ina219->setCalibration_32V_2A();
+        break;
+      default:
+        ina219->getSample(&sample);
+        count++;
+        break;
+    }
+  }
+  double elapsed_s = (micros() - start) * 1e-6;
+  uint32_t done = sim->getTransactions(INA219_ADDRESS) - before;
+
+  // writes are counted on the bus, a calibration takes several
+  if (op == OP_WRITE)
+    count = done;
+  *transactions = (double)done / count;
+  return count / elapsed_s;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t n = 2000;
+  bool real = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:r")) != -1) {
+    switch (opt) {
+      case 'n': n = strtoul(optarg, NULL, 0); break;
+      case 'r': real = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-n operations] [-r]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  printf("%s time, %u operations each; per second (transactions with the chip each)\n",
+         real ? "real" : "virtual", n);
+  printf("clock          register reads    register writes   "
+         "samples           samples, sw power\n");
+  for (size_t c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+    Adafruit_INA219_Sim sim;
+    Adafruit_INA219 ina219;
+
+    Wire.setSimulator(&sim);
+    sim.setVirtualTime(!real);
+    sim.setBusTiming(true);
+    sim.addDevice(INA219_ADDRESS);
+    sim.setInput(INA219_ADDRESS, 10000, 5000);
+    ina219.begin();
+    uint32_t clock_Hz = ina219.setI2CClock(clocks[c].clock_Hz);
+    if (clock_Hz != clocks[c].clock_Hz) {
+      printf("%-14s not available, build with INA219_I2C_HS_CAPABLE\n", clocks[c].name);
+      continue;
+    }
+
+    printf("%-14s", clocks[c].name);
+    for (int op = 0; op < OPS; op++) {
+      double transactions;
+      double rate = run(&ina219, &sim, op, n, &transactions);
+      printf(" %7.0f (%.1f)     ", rate, transactions);
+    }
+    printf("\n");
+    sim.setVirtualTime(false);
+  }
+  Wire.setSimulator(NULL);
+  return 0;
+}
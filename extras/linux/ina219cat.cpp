@@ -0,0 +1,73 @@
+/**************************************************************************/
+/*! 
+    @file     ina219cat.cpp
+	@license  BSD (see license.txt)
+	
+	Prints the samples published by ina219d as CSV, an example reader
+	of the shared-memory ring
+
+	Usage: ina219cat [ring_name]
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Adafruit_INA219_Ring.h"
+
+int main(int argc, char **argv)
+{
+  Adafruit_INA219_RingReader ring;
+  const char *name = (argc > 1) ? argv[1] : INA219_RING_DEFAULT_NAME;
+
+  if (!ring.open(name)) {
+    fprintf(stderr, "ina219cat: can't open ring %s\n", name);
+    return 1;
+  }
+
+  const ina219_ring_header_t *header = ring.header();
+  uint64_t next = ring.head() + 1;
+  ina219_record_t record;
+  time_t checked = time(NULL);
+
+  printf("seq,time_ns,address,shunt_mV,bus_V,current_mA,power_mW,flags,status\n");
+  for (;;) {
+    int got = ring.read(&next, &record);
+    if (got == 0) {
+      // a restarted daemon creates a new ring, once a second check
+      // whether it did
+      time_t now = time(NULL);
+      if (now != checked) {
+        checked = now;
+        if (ring.replaced()) {
+          if (!ring.open(name)) {
+            fprintf(stderr, "ina219cat: can't open ring %s\n", name);
+            return 1;
+          }
+          header = ring.header();
+          next = ring.head() + 1;
+          fprintf(stderr, "ina219cat: ring replaced, following the new one\n");
+        }
+      }
+      usleep(header->period_ns / 4000);
+      continue;
+    }
+    if (got < 0) {
+      fprintf(stderr, "ina219cat: overrun, skipped to %llu\n", (unsigned long long)next);
+      continue;
+    }
+
+    float lsb = header->sensor[record.sensor].currentLsb_mA;
+    printf("%llu,%llu,0x%02x,%.2f,%.3f,%.3f,%.3f,%u,%u\n",
+           (unsigned long long)(next - 1), (unsigned long long)record.time_ns,
+           record.address, record.shunt * 0.01, record.bus * 0.001,
+           record.current * lsb, record.power * lsb / 1000,
+           record.flags, record.status);
+    fflush(stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,148 @@
+/**************************************************************************/
+/*! 
+    @file     ina219codec.cpp
+	@license  BSD (see license.txt)
+	
+	Benchmark of the record codec on simulated waveforms: bytes per
+	record (shunt, bus, current and power with timestamp and flags),
+	encode / decode throughput, and a check that decoding gives back
+	every record
+
+	Usage: ina219codec [-n records]
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Adafruit_INA219_Codec.h"
+
+#define PERIOD_NS     (10000000)     // 100 Hz
+#define JITTER_NS     (20000.0)      // read time spread
+#define CAL           (4096)         // 32V_2A: 0.1mA per LSB, current == shunt
+
+typedef struct {
+  const char *name;
+  double mean_mA;
+  double noise_lsb;   // shunt noise, sigma
+  double ripple_mA;   // 120 Hz, aliased by the 100 Hz sampling
+  double step_mA;     // square load step every 0.5 s
+} waveform_t;
+
+static const waveform_t waveforms[] = {
+  { "quiet",   250, 0.5,  0,   0 },
+  { "ripple",  250, 0.5, 20,   0 },
+  { "steps",   100, 1.0,  0, 900 },
+  { "noisy",   250, 8.0,  0,   0 },
+};
+
+static double gauss(void)
+{
+  double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static double now_s(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Simulates what ina219d records for a 5V rail through 0.1 ohm
+*/
+/**************************************************************************/
+static void simulate(const waveform_t *w, bool softwarePower, ina219_record_t *records, uint32_t n)
+{
+  uint64_t start_ns = 1700000000ULL * 1000000000ULL;
+  srand(1);
+  for (uint32_t i = 0; i < n; i++) {
+    double t = i * (PERIOD_NS / 1e9);
+    double mA = w->mean_mA + w->ripple_mA * sin(2 * M_PI * 120 * t) +
+                ((fmod(t, 1.0) < 0.5) ? 0 : w->step_mA);
+    int16_t shunt = (int16_t)lround(mA * 10 + w->noise_lsb * gauss());
+    int16_t bus = (int16_t)(lround((5000 - mA * 0.05 + 2 * gauss()) / 4) * 4);
+    ina219_record_t *r = &records[i];
+
+    memset(r, 0, sizeof(*r));
+    r->time_ns = start_ns + (uint64_t)i * PERIOD_NS + (int64_t)(JITTER_NS * fabs(gauss()));
+    r->sensor = 0;
+    r->address = 0x40;
+    r->flags = 0x02;          // CNVR
+    r->shunt = shunt;
+    r->bus = bus;
+    r->current = (int16_t)(shunt * CAL / 4096);
+    r->power = softwarePower ? r->current * bus : r->current * bus / 20000 * 20000;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t n = 1000000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1) {
+    switch (opt) {
+      case 'n': n = strtoul(optarg, NULL, 0); break;
+      default:
+        fprintf(stderr, "usage: %s [-n records]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  ina219_record_t *records = (ina219_record_t *)malloc(n * sizeof(ina219_record_t));
+  size_t size = INA219_CODEC_HEADER_BYTES + (size_t)n * INA219_CODEC_MAX_RECORD_BYTES;
+  uint8_t *buffer = (uint8_t *)malloc(size);
+  Adafruit_INA219_Encoder encoder;
+  Adafruit_INA219_Decoder decoder;
+  int failures = 0;
+
+  printf("waveform power    time_res  bytes/record  encode_M/s  decode_M/s  check\n");
+  for (size_t w = 0; w < sizeof(waveforms) / sizeof(waveforms[0]); w++) {
+    for (int hw = 0; hw < 2; hw++) {
+      simulate(&waveforms[w], !hw, records, n);
+      for (uint32_t res = 1000; res <= 1000000; res *= 1000) {
+        double t0 = now_s();
+        encoder.begin(buffer, size, CAL, res);
+        for (uint32_t i = 0; i < n; i++)
+          encoder.add(&records[i]);
+        size_t bytes = encoder.finish();
+        double t1 = now_s();
+
+        ina219_record_t out;
+        uint32_t bad = 0;
+        decoder.begin(buffer, bytes, encoder.getCount());
+        for (uint32_t i = 0; i < n; i++) {
+          if (!decoder.next(&out)) {
+            bad++;
+            break;
+          }
+          uint64_t rounded = (records[i].time_ns + res / 2) / res * res;
+          if (out.time_ns != rounded || out.shunt != records[i].shunt ||
+              out.bus != records[i].bus || out.current != records[i].current ||
+              out.power != records[i].power || out.flags != records[i].flags)
+            bad++;
+        }
+        double t2 = now_s();
+        failures += bad != 0;
+
+        printf("%-8s %-8s %5u us  %12.3f  %10.1f  %10.1f  %s\n",
+               waveforms[w].name, hw ? "register" : "software", res / 1000,
+               (double)bytes / n, n / (t1 - t0) / 1e6, n / (t2 - t1) / 1e6,
+               bad ? "FAILED" : "ok");
+      }
+    }
+  }
+  free(records);
+  free(buffer);
+  return failures ? 1 : 0;
+}
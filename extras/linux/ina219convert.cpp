@@ -0,0 +1,159 @@
+/**************************************************************************/
+/*! 
+    @file     ina219convert.cpp
+	@license  BSD (see license.txt)
+	
+	Checks and benchmarks the batch conversion kernels: every path
+	must give the scalar path's bits on all 65536 register values (and
+	random sample powers), the scalar path the driver's own
+	getCurrent_mA(sample) / getPower_mW(sample) bits, then each kernel
+	is timed on each path
+
+	Usage: ina219convert [-n values] [-r rounds]
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Adafruit_INA219.h"
+#include "Adafruit_INA219_Convert.h"
+
+#define ALL_VALUES   (65536)
+
+static int16_t raw[ALL_VALUES];
+static int32_t power[ALL_VALUES];
+static float outF[INA219_CONVERT_AVX2 + 1][ALL_VALUES];
+static int32_t outI[INA219_CONVERT_AVX2 + 1][ALL_VALUES];
+
+static double now_s(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Runs kernel 'k' on 'n' values from the start of the inputs
+*/
+/**************************************************************************/
+static void run(int k, uint8_t path, size_t n)
+{
+  const uint16_t *reg = (const uint16_t *)raw;
+  float *f = outF[path];
+  int32_t *i = outI[path];
+
+  switch (k) {
+    case 0: Adafruit_INA219_Convert::shuntVoltage_mV(raw, f, n); break;
+    case 1: Adafruit_INA219_Convert::busVoltage_V(reg, f, n); break;
+    case 2: Adafruit_INA219_Convert::current_mA(raw, 0.1f, f, n); break;
+    case 3: Adafruit_INA219_Convert::power_mW(raw, 2.0f, f, n); break;
+    case 4: Adafruit_INA219_Convert::samplePower_mW(power, 0.0488f, f, n); break;
+    case 5: Adafruit_INA219_Convert::shuntVoltage_uV(raw, i, n); break;
+    case 6: Adafruit_INA219_Convert::busVoltage_mV(reg, i, n); break;
+    case 7: Adafruit_INA219_Convert::current_uA(raw, 40, i, n); break;
+    case 8: Adafruit_INA219_Convert::power_uW(reg, 100, i, n); break;
+  }
+}
+
+static const char *kernels[] = {
+  "shuntVoltage_mV", "busVoltage_V", "current_mA", "power_mW", "samplePower_mW",
+  "shuntVoltage_uV", "busVoltage_mV", "current_uA", "power_uW",
+};
+#define KERNELS  (sizeof(kernels) / sizeof(kernels[0]))
+
+int main(int argc, char **argv)
+{
+  size_t n = 4096;
+  uint32_t rounds = 20000;
+  int failures = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+    switch (opt) {
+      case 'n': n = strtoul(optarg, NULL, 0); break;
+      case 'r': rounds = strtoul(optarg, NULL, 0); break;
+      default:
+        fprintf(stderr, "usage: %s [-n values] [-r rounds]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (n == 0 || n > ALL_VALUES)
+    n = ALL_VALUES;
+
+  srand(1);
+  for (int v = 0; v < ALL_VALUES; v++) {
+    raw[v] = (int16_t)v;
+    power[v] = (int32_t)(((uint32_t)rand() << 16) ^ rand());
+  }
+  power[0] = INT32_MAX;
+  power[1] = INT32_MIN;
+
+  // every path against the scalar one, on all register values; odd
+  // lengths exercise the tails
+  for (size_t k = 0; k < KERNELS; k++)
+    for (uint8_t path = INA219_CONVERT_SCALAR; path <= INA219_CONVERT_AVX2; path++) {
+      if (!Adafruit_INA219_Convert::hasPath(path))
+        continue;
+      Adafruit_INA219_Convert::setPath(path);
+      memset(outF[path], 0, sizeof(outF[path]));
+      memset(outI[path], 0, sizeof(outI[path]));
+      run(k, path, ALL_VALUES - 3);
+      if (memcmp(outF[path], outF[INA219_CONVERT_SCALAR], sizeof(outF[path])) != 0 ||
+          memcmp(outI[path], outI[INA219_CONVERT_SCALAR], sizeof(outI[path])) != 0) {
+        printf("%s: %s differs from scalar\n", kernels[k],
+               Adafruit_INA219_Convert::getPathName(path));
+        failures++;
+      }
+    }
+
+  // the scalar path against the driver's sample conversions
+  Adafruit_INA219 ina219;
+  ina219.setCalibration_32V_1A();
+  float lsb = ina219.getCurrentLsb_mA();
+  Adafruit_INA219_Convert::setPath(INA219_CONVERT_SCALAR);
+  Adafruit_INA219_Convert::current_mA(raw, lsb, outF[0], ALL_VALUES);
+  Adafruit_INA219_Convert::samplePower_mW(power, lsb, outF[1], ALL_VALUES);
+  for (int v = 0; v < ALL_VALUES; v++) {
+    ina219_sample_t sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.current = raw[v];
+    sample.power = power[v];
+    float current = ina219.getCurrent_mA(&sample), watts = ina219.getPower_mW(&sample);
+    if (memcmp(&current, &outF[0][v], sizeof(float)) != 0 ||
+        memcmp(&watts, &outF[1][v], sizeof(float)) != 0) {
+      printf("scalar differs from the driver at %d\n", v);
+      failures++;
+      break;
+    }
+  }
+  printf("bit-identical check: %s\n\n", failures ? "FAILED" : "ok");
+
+  printf("%-16s", "M values/s");
+  for (uint8_t path = INA219_CONVERT_SCALAR; path <= INA219_CONVERT_AVX2; path++)
+    printf("%10s", Adafruit_INA219_Convert::getPathName(path));
+  printf("\n");
+  for (size_t k = 0; k < KERNELS; k++) {
+    printf("%-16s", kernels[k]);
+    for (uint8_t path = INA219_CONVERT_SCALAR; path <= INA219_CONVERT_AVX2; path++) {
+      if (!Adafruit_INA219_Convert::hasPath(path)) {
+        printf("%10s", "-");
+        continue;
+      }
+      Adafruit_INA219_Convert::setPath(path);
+      double start = now_s();
+      for (uint32_t r = 0; r < rounds; r++)
+        run(k, path, n);
+      printf("%10.0f", (double)n * rounds / (now_s() - start) / 1e6);
+    }
+    printf("\n");
+  }
+  return failures ? 1 : 0;
+}
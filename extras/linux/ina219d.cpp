@@ -0,0 +1,241 @@
+/**************************************************************************/
+/*! 
+    @file     ina219d.cpp
+	@license  BSD (see license.txt)
+	
+	INA219 sampling daemon for Linux hosts
+
+	Samples every configured sensor once per period and publishes the
+	raw samples to a shared-memory ring (see Adafruit_INA219_Ring.h),
+	so any number of local processes can read them while the I2C bus
+	only sees one set of reads per period.
+
+	Usage: ina219d [-d /dev/i2c-1] [-a 0x40,0x41,...] [-p period_ms]
+	               [-C 32V_2A|32V_1A|16V_400mA] [-w]
+	               [-n ring_name] [-s slots] [-m metrics_port]
+	               [-r rt_priority] [-c cpu] [-l]
+	               [-f log_file] [-k log_slots] [-F sync_ms]
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "Adafruit_INA219.h"
+#include "Adafruit_INA219_Ring.h"
+#include "Adafruit_INA219_Metrics.h"
+#include "Adafruit_INA219_Scheduler.h"
+#include "Adafruit_INA219_Log.h"
+
+static Adafruit_INA219_Scheduler scheduler;
+
+static void stop(int sig)
+{
+  (void)sig;
+  scheduler.stop();
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [-d /dev/i2c-1] [-a 0x40,0x41,...] [-p period_ms]\n"
+          "          [-C 32V_2A|32V_1A|16V_400mA] [-w]\n"
+          "          [-n ring_name] [-s slots] [-m metrics_port]\n"
+          "          [-r rt_priority] [-c cpu] [-l]\n"
+          "          [-f log_file] [-k log_slots] [-F sync_ms]\n", name);
+  exit(1);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Returns CLOCK_REALTIME in ns, the record timestamps
+*/
+/**************************************************************************/
+static uint64_t realtime_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+typedef struct {
+  Adafruit_INA219 **sensors;
+  uint8_t *addresses;
+  int count;
+  Adafruit_INA219_RingWriter *ring;
+  Adafruit_INA219_Metrics *metrics;
+  Adafruit_INA219_Log *log;
+} sampler_t;
+
+/**************************************************************************/
+/*! 
+    @brief  Reads one sample from each sensor and publishes it
+*/
+/**************************************************************************/
+static void sampleAll(void *arg, uint64_t deadline_ns)
+{
+  sampler_t *s = (sampler_t *)arg;
+  (void)deadline_ns;
+
+  for (int i = 0; i < s->count; i++) {
+    Adafruit_INA219 *sensor = s->sensors[i];
+    ina219_sample_t sample;
+    ina219_record_t record;
+
+    sensor->getSample(&sample);
+    memset(&record, 0, sizeof(record));
+    record.time_ns = realtime_ns();
+    record.sensor = i;
+    record.address = s->addresses[i];
+    record.flags = sample.flags;
+    record.status = sensor->getLastError();
+    record.shunt = sample.shunt;
+    record.bus = sample.bus;
+    record.current = sample.current;
+    record.power = sample.power;
+    s->ring->publish(&record);
+    if (s->log != NULL)
+      s->log->append(&record);
+    if (s->metrics != NULL)
+      s->metrics->update(i, &record, sensor->getCurrentLsb_mA(),
+                         sensor->getErrorCount(), sensor->getRetryCount());
+  }
+}
+
+int main(int argc, char **argv)
+{
+  const char *device = "/dev/i2c-1";
+  const char *ringName = INA219_RING_DEFAULT_NAME;
+  const char *calibration = "32V_2A";
+  uint32_t period_ms = 100;
+  uint32_t slots = 4096;
+  uint16_t metricsPort = 0;
+  int rtPriority = 0;
+  int cpu = -1;
+  bool lockMemory = false;
+  const char *logPath = NULL;
+  uint32_t logSlots = INA219_LOG_DEFAULT_SLOTS;
+  uint32_t sync_ms = 1000;
+  bool softwarePower = false;
+  uint8_t addresses[INA219_RING_MAX_SENSORS];
+  int count = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:a:p:C:wn:s:m:r:c:lf:k:F:")) != -1) {
+    switch (opt) {
+      case 'd': device = optarg; break;
+      case 'p': period_ms = strtoul(optarg, NULL, 0); break;
+      case 'C': calibration = optarg; break;
+      case 'w': softwarePower = true; break;
+      case 'n': ringName = optarg; break;
+      case 's': slots = strtoul(optarg, NULL, 0); break;
+      case 'm': metricsPort = strtoul(optarg, NULL, 0); break;
+      case 'r': rtPriority = atoi(optarg); break;
+      case 'c': cpu = atoi(optarg); break;
+      case 'l': lockMemory = true; break;
+      case 'f': logPath = optarg; break;
+      case 'k': logSlots = strtoul(optarg, NULL, 0); break;
+      case 'F': sync_ms = strtoul(optarg, NULL, 0); break;
+      case 'a':
+        for (char *tok = strtok(optarg, ","); tok != NULL && count < INA219_RING_MAX_SENSORS;
+             tok = strtok(NULL, ","))
+          addresses[count++] = strtoul(tok, NULL, 0);
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (count == 0)
+    addresses[count++] = INA219_ADDRESS;
+  if (period_ms == 0 || slots == 0 || logSlots == 0 || sync_ms == 0)
+    usage(argv[0]);
+
+  Wire.setDevice(device);
+  if (!Wire.begin()) {
+    perror(device);
+    return 1;
+  }
+
+  Adafruit_INA219 *sensors[INA219_RING_MAX_SENSORS];
+  Adafruit_INA219_RingWriter ring;
+  if (!ring.create(ringName, slots, count, (uint64_t)period_ms * 1000000)) {
+    perror(ringName);
+    return 1;
+  }
+
+  for (int i = 0; i < count; i++) {
+    sensors[i] = new Adafruit_INA219(addresses[i]);
+    sensors[i]->begin();
+    if (strcmp(calibration, "32V_1A") == 0)
+      sensors[i]->setCalibration_32V_1A();
+    else if (strcmp(calibration, "16V_400mA") == 0)
+      sensors[i]->setCalibration_16V_400mA();
+    sensors[i]->setSoftwarePower(softwarePower);
+    if (sensors[i]->getLastError() != INA219_OK)
+      fprintf(stderr, "ina219d: no answer from 0x%02x\n", addresses[i]);
+    ring.setSensor(i, addresses[i], sensors[i]->getCurrentLsb_mA());
+  }
+
+  Adafruit_INA219_Log log;
+  if (logPath != NULL) {
+    if (!log.open(logPath, logSlots)) {
+      perror(logPath);
+      return 1;
+    }
+    if (log.head() != 0)
+      fprintf(stderr, "ina219d: %s: recovered %llu records up to %llu\n", logPath,
+              (unsigned long long)log.getRecovered(), (unsigned long long)log.head());
+    log.setSensors(count);
+    for (int i = 0; i < count; i++)
+      log.setSensor(i, addresses[i], sensors[i]->getCurrentLsb_mA());
+    if (!log.startSync(sync_ms)) {
+      perror("ina219d: log sync");
+      return 1;
+    }
+  }
+
+  Adafruit_INA219_Metrics metrics;
+  if (metricsPort && !metrics.begin(metricsPort, count)) {
+    perror("ina219d: metrics port");
+    return 1;
+  }
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  // timerfd on absolute deadlines so the period doesn't drift with the read time
+  sampler_t sampler = { sensors, addresses, count, &ring,
+                        metricsPort ? &metrics : NULL, logPath ? &log : NULL };
+  if (!scheduler.begin() || scheduler.add(period_ms * 1000, sampleAll, &sampler) < 0) {
+    perror("ina219d: scheduler");
+    return 1;
+  }
+  // only the sampling thread, the metrics thread keeps the normal policy
+  if (!Adafruit_INA219_Scheduler::setRealtime(rtPriority, cpu, lockMemory)) {
+    perror("ina219d: real-time setup");
+    return 1;
+  }
+  scheduler.run();
+
+  ina219_sched_stats_t stats;
+  scheduler.getStats(0, &stats);
+  fprintf(stderr, "ina219d: %llu periods, %llu late, %llu missed, lateness %.0f us mean %.0f us max\n",
+          (unsigned long long)stats.runs, (unsigned long long)stats.late,
+          (unsigned long long)stats.missed, stats.mean_ns / 1e3, stats.max_ns / 1e3);
+  scheduler.end();
+  metrics.end();
+  log.close();
+  ring.close();
+  shm_unlink(ringName);
+  for (int i = 0; i < count; i++)
+    delete sensors[i];
+  return 0;
+}
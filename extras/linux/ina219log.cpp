@@ -0,0 +1,105 @@
+/**************************************************************************/
+/*! 
+    @file     ina219log.cpp
+	@license  BSD (see license.txt)
+	
+	Prints the records recovered from an ina219d log file as CSV, or
+	with -b measures the cost of appending 'count' records to it
+
+	Usage: ina219log [-b count] log_file
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Adafruit_INA219_Log.h"
+
+static double now_s(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Appends 'count' records and times the appends and one sync
+*/
+/**************************************************************************/
+static int bench(const char *path, uint32_t count)
+{
+  Adafruit_INA219_Log log;
+  ina219_record_t record;
+
+  if (!log.open(path)) {
+    perror(path);
+    return 1;
+  }
+  memset(&record, 0, sizeof(record));
+
+  double start = now_s();
+  for (uint32_t i = 0; i < count; i++) {
+    record.time_ns = i;
+    record.shunt = i;
+    log.append(&record);
+  }
+  double appended = now_s();
+  log.sync();
+  double synced = now_s();
+
+  printf("%u appends: %.1f ns/record, sync %.1f ms\n", count,
+         (appended - start) * 1e9 / count, (synced - appended) * 1e3);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t benchCount = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "b:")) != -1) {
+    switch (opt) {
+      case 'b': benchCount = strtoul(optarg, NULL, 0); break;
+      default:
+        fprintf(stderr, "usage: %s [-b count] log_file\n", argv[0]);
+        return 1;
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "usage: %s [-b count] log_file\n", argv[0]);
+    return 1;
+  }
+  if (benchCount)
+    return bench(argv[optind], benchCount);
+
+  Adafruit_INA219_Log log;
+  if (!log.open(argv[optind], INA219_LOG_DEFAULT_SLOTS, true)) {
+    perror(argv[optind]);
+    return 1;
+  }
+  const ina219_log_header_t *header = log.header();
+  fprintf(stderr, "ina219log: records %llu to %llu, committed up to %llu\n",
+          (unsigned long long)log.oldest(), (unsigned long long)log.head(),
+          (unsigned long long)header->commit);
+
+  printf("seq,time_ns,address,shunt_mV,bus_V,current_mA,power_mW,flags,status\n");
+  ina219_record_t record;
+  for (uint64_t seq = log.oldest(); seq != 0 && seq <= log.head(); seq++) {
+    if (!log.read(seq, &record))
+      continue;
+    float lsb = header->sensor[record.sensor].currentLsb_mA;
+    printf("%llu,%llu,0x%02x,%.2f,%.3f,%.3f,%.3f,%u,%u\n",
+           (unsigned long long)seq, (unsigned long long)record.time_ns,
+           record.address, record.shunt * 0.01, record.bus * 0.001,
+           record.current * lsb, record.power * lsb / 1000,
+           record.flags, record.status);
+  }
+  return 0;
+}
@@ -0,0 +1,114 @@
+/**************************************************************************/
+/*! 
+    @file     ina219rollup.cpp
+	@license  BSD (see license.txt)
+	
+	Rolls up the samples published by ina219d and prints each bucket
+	of the chosen level as CSV once it is complete
+
+	Usage: ina219rollup [-l s|m|h] [ring_name]
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Adafruit_INA219_Ring.h"
+#include "Adafruit_INA219_Rollup.h"
+
+static void printBucket(uint8_t sensor, uint8_t address, const ina219_rollup_t *b)
+{
+  printf("%u,0x%02x,%lld,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.6f\n",
+         sensor, address, (long long)b->start_s, b->count,
+         b->current_mA.min, b->current_mA.sum / b->count, b->current_mA.max,
+         b->bus_V.min, b->bus_V.sum / b->count, b->bus_V.max,
+         b->power_mW.min, b->power_mW.sum / b->count, b->power_mW.max,
+         b->energy_J);
+}
+
+int main(int argc, char **argv)
+{
+  Adafruit_INA219_RingReader ring;
+  Adafruit_INA219_Rollup rollup;
+  uint8_t level = INA219_ROLLUP_MINUTE;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "l:")) != -1) {
+    switch (opt) {
+      case 'l':
+        level = (optarg[0] == 's') ? INA219_ROLLUP_SECOND :
+                (optarg[0] == 'h') ? INA219_ROLLUP_HOUR : INA219_ROLLUP_MINUTE;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-l s|m|h] [ring_name]\n", argv[0]);
+        return 1;
+    }
+  }
+  const char *name = (optind < argc) ? argv[optind] : INA219_RING_DEFAULT_NAME;
+
+  if (!ring.open(name)) {
+    fprintf(stderr, "ina219rollup: can't open ring %s\n", name);
+    return 1;
+  }
+  const ina219_ring_header_t *header = ring.header();
+  if (!rollup.begin(header->sensors)) {
+    perror("ina219rollup");
+    return 1;
+  }
+  fprintf(stderr, "ina219rollup: %u sensors, %zu bytes of buckets\n",
+          header->sensors, rollup.getMemory());
+
+  uint32_t sensors = header->sensors;
+  uint64_t next = ring.head() + 1;
+  ina219_record_t record;
+  time_t checked = time(NULL);
+  uint32_t d = Adafruit_INA219_Rollup::getDuration_s(level);
+
+  printf("sensor,address,start_s,count,current_min_mA,current_mean_mA,current_max_mA,"
+         "bus_min_V,bus_mean_V,bus_max_V,power_min_mW,power_mean_mW,power_max_mW,energy_J\n");
+  for (;;) {
+    int got = ring.read(&next, &record);
+    if (got == 0) {
+      // follow a restarted daemon's new ring, the buckets carry on
+      time_t now = time(NULL);
+      if (now != checked) {
+        checked = now;
+        if (ring.replaced()) {
+          if (!ring.open(name)) {
+            fprintf(stderr, "ina219rollup: can't open ring %s\n", name);
+            return 1;
+          }
+          header = ring.header();
+          next = ring.head() + 1;
+          fprintf(stderr, "ina219rollup: ring replaced, following the new one\n");
+        }
+      }
+      usleep(header->period_ns / 4000);
+      continue;
+    }
+    if (got < 0) {
+      fprintf(stderr, "ina219rollup: overrun, skipped to %llu\n", (unsigned long long)next);
+      continue;
+    }
+    if (record.status != 0 || record.sensor >= sensors)
+      continue;
+
+    float lsb = header->sensor[record.sensor].currentLsb_mA;
+    uint8_t closed = rollup.add(record.sensor, record.time_ns, record.current * lsb,
+                                record.bus * 0.001f, record.power * lsb / 1000);
+    if (closed & (1 << level)) {
+      // the bucket before the one this sample opened is complete
+      int64_t start_s = (int64_t)(record.time_ns / 1000000000) / d * d;
+      ina219_rollup_t bucket;
+      if (rollup.query(record.sensor, level, start_s - d, start_s, &bucket, 1))
+        printBucket(record.sensor, record.address, &bucket);
+      fflush(stdout);
+    }
+  }
+  return 0;
+}
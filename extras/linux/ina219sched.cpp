@@ -0,0 +1,195 @@
+/**************************************************************************/
+/*! 
+    @file     ina219sched.cpp
+	@license  BSD (see license.txt)
+	
+	Benchmark of the timerfd/epoll scheduler: runs 'tasks' dummy reads
+	spread over the given periods from one thread and prints their
+	rate, lateness and late/missed counts
+
+	-S starts that many CPU stress threads (pinned to the same core as
+	the scheduler when -c is given); -r, -c and -l set up the
+	scheduler thread as with ina219d, so running with and without them
+	compares the normal and real-time configurations under load.
+
+	Usage: ina219sched [-t tasks] [-p period_us,...] [-w work_us]
+	                   [-s seconds] [-S stress_threads]
+	                   [-r rt_priority] [-c cpu] [-l]
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "Adafruit_INA219_Scheduler.h"
+
+static Adafruit_INA219_Scheduler scheduler;
+static volatile bool stressing = true;
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [-t tasks] [-p period_us,...] [-w work_us] [-s seconds]\n"
+          "          [-S stress_threads] [-r rt_priority] [-c cpu] [-l]\n", name);
+  exit(1);
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Stands for a sensor read, spinning 'work_us'
+*/
+/**************************************************************************/
+static void dummyRead(void *arg, uint64_t deadline_ns)
+{
+  uint64_t end_ns = Adafruit_INA219_Scheduler::now_ns() + *(uint32_t *)arg * 1000ULL;
+  (void)deadline_ns;
+  while (Adafruit_INA219_Scheduler::now_ns() < end_ns)
+    ;
+}
+
+/**************************************************************************/
+/*! 
+    @brief  Synthetic load: arithmetic over a buffer larger than the
+            caches, so it competes for the core and the memory bus
+*/
+/**************************************************************************/
+static void *stress(void *arg)
+{
+  const size_t size = 8 << 20;
+  volatile uint32_t *buffer = (volatile uint32_t *)calloc(size, sizeof(uint32_t));
+  uint32_t x = 1;
+  (void)arg;
+  while (stressing)
+    for (size_t i = 0; i < size && stressing; i += 16) {
+      x = x * 1664525 + 1013904223;
+      buffer[i] += x;
+    }
+  free((void *)buffer);
+  return NULL;
+}
+
+static void stopAll(void *arg, uint64_t deadline_ns)
+{
+  (void)arg;
+  (void)deadline_ns;
+  scheduler.stop();
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t periods[INA219_SCHED_MAX_PERIODS];
+  int periodCount = 0;
+  int tasks = 64;
+  uint32_t work_us = 0;
+  uint32_t seconds = 5;
+  int stressThreads = 0;
+  int rtPriority = 0;
+  int cpu = -1;
+  bool lockMemory = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:p:w:s:S:r:c:l")) != -1) {
+    switch (opt) {
+      case 't': tasks = atoi(optarg); break;
+      case 'w': work_us = strtoul(optarg, NULL, 0); break;
+      case 's': seconds = strtoul(optarg, NULL, 0); break;
+      case 'S': stressThreads = atoi(optarg); break;
+      case 'r': rtPriority = atoi(optarg); break;
+      case 'c': cpu = atoi(optarg); break;
+      case 'l': lockMemory = true; break;
+      case 'p':
+        for (char *tok = strtok(optarg, ","); tok != NULL && periodCount < INA219_SCHED_MAX_PERIODS;
+             tok = strtok(NULL, ","))
+          periods[periodCount++] = strtoul(tok, NULL, 0);
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (periodCount == 0) {
+    periods[periodCount++] = 10000;
+    periods[periodCount++] = 20000;
+    periods[periodCount++] = 50000;
+    periods[periodCount++] = 100000;
+  }
+  if (tasks <= 0 || tasks >= INA219_SCHED_MAX_TASKS || seconds == 0)
+    usage(argv[0]);
+
+  pthread_t stressers[64];
+  if (stressThreads > 64)
+    stressThreads = 64;
+  for (int i = 0; i < stressThreads; i++) {
+    pthread_create(&stressers[i], NULL, stress, NULL);
+    if (cpu >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      pthread_setaffinity_np(stressers[i], sizeof(set), &set);
+    }
+  }
+  if (!Adafruit_INA219_Scheduler::setRealtime(rtPriority, cpu, lockMemory)) {
+    perror("ina219sched: real-time setup");
+    return 1;
+  }
+
+  if (!scheduler.begin()) {
+    perror("ina219sched");
+    return 1;
+  }
+  int ids[INA219_SCHED_MAX_TASKS];
+  for (int i = 0; i < tasks; i++)
+    if ((ids[i] = scheduler.add(periods[i % periodCount], dummyRead, &work_us)) < 0) {
+      perror("ina219sched: add");
+      return 1;
+    }
+  scheduler.add(seconds * 1000000, stopAll, NULL);
+  scheduler.run();
+  stressing = false;
+  for (int i = 0; i < stressThreads; i++)
+    pthread_join(stressers[i], NULL);
+
+  printf("period_us tasks  reads/s  late  missed  lateness_us: min   mean  stddev    max\n");
+  double total = 0;
+  for (int p = 0; p < periodCount; p++) {
+    ina219_sched_stats_t sum, s;
+    int n = 0;
+    memset(&sum, 0, sizeof(sum));
+    sum.min_ns = UINT64_MAX;
+    for (int i = p; i < tasks; i += periodCount) {
+      scheduler.getStats(ids[i], &s);
+      // pooled mean and variance over the tasks of this period
+      double mean = (sum.mean_ns * sum.runs + s.mean_ns * s.runs) / (sum.runs + s.runs);
+      sum.stddev_ns += s.stddev_ns * s.stddev_ns * (s.runs - 1)
+                       + s.runs * (s.mean_ns - mean) * (s.mean_ns - mean)
+                       + sum.runs * (sum.mean_ns - mean) * (sum.mean_ns - mean);
+      sum.mean_ns = mean;
+      sum.runs += s.runs;
+      sum.late += s.late;
+      sum.missed += s.missed;
+      if (s.min_ns < sum.min_ns)
+        sum.min_ns = s.min_ns;
+      if (s.max_ns > sum.max_ns)
+        sum.max_ns = s.max_ns;
+      n++;
+    }
+    if (n == 0)
+      continue;
+    total += (double)sum.runs / seconds;
+    printf("%9u %5d %8.0f %5llu %7llu  %16.1f %6.1f %7.1f %6.1f\n",
+           periods[p], n, (double)sum.runs / seconds,
+           (unsigned long long)sum.late, (unsigned long long)sum.missed,
+           sum.min_ns / 1e3, sum.mean_ns / 1e3,
+           sum.runs > 1 ? sqrt(sum.stddev_ns / (sum.runs - 1)) / 1e3 : 0, sum.max_ns / 1e3);
+  }
+  printf("total %.0f reads/s\n", total);
+  return 0;
+}
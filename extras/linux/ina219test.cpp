@@ -0,0 +1,860 @@
+/**************************************************************************/
+/*!
+    @file     ina219test.cpp
+	@license  BSD (see license.txt)
+
+	Regression tests of the driver against the simulated bus (see
+	Adafruit_INA219_Sim.h), including the decimation, capture, Goertzel
+	and Tiny add-ons, and of the daemon's sample log and rollups, run
+	by 'make check'.  Prints one line per
+	test and exits with 1 if any failed.
+
+	Usage: ina219test [test ...]
+
+	@section  HISTORY
+
+    v1.0 - First release
+*/
+/**************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Adafruit_INA219.h"
+#include "Adafruit_INA219_Capture.h"
+#include "Adafruit_INA219_Decimator.h"
+#include "Adafruit_INA219_Goertzel.h"
+#include "Adafruit_INA219_Group.h"
+#include "Adafruit_INA219_Log.h"
+#include "Adafruit_INA219_Rollup.h"
+#include "Adafruit_INA219_Sim.h"
+#include "Adafruit_INA219_Tiny.h"
+
+static int failures;
+
+#define CHECK(cond, ...)                                        \
+  do {                                                          \
+    if (!(cond)) {                                              \
+      printf("    %s:%d: ", __FILE__, __LINE__);                \
+      printf(__VA_ARGS__);                                      \
+      printf("\n");                                             \
+      failures++;                                               \
+    }                                                           \
+  } while (0)
+
+/**************************************************************************/
+/*!
+    @brief  Polls readConversion() until 'count' conversion intervals
+            have been measured, or 10 s
+*/
+/**************************************************************************/
+static void pollConversions(Adafruit_INA219 *ina219, uint32_t count, ina219_jitter_t *jitter)
+{
+  uint32_t start = millis();
+  int16_t shunt, bus;
+
+  ina219->resetJitter();
+  do {
+    ina219->readConversion(&shunt, &bus);
+    ina219->getJitter(jitter);
+  } while (jitter->count < count && millis() - start < 10000);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Conversion-edge timestamps, in virtual time: with polls 2us
+            apart the measured interval has to be the conversion time
+            and the measured jitter the simulated oscillator jitter.
+            At 400kHz a poll (pointer write and read, 49 SCL periods)
+            takes 122.5us: each edge is then off by up to half of that,
+            which adds g^2/6 to the variance of the intervals.
+*/
+/**************************************************************************/
+static void testJitter(void)
+{
+  static const struct {
+    uint32_t jitter_us;
+    uint32_t clock_Hz;          // 0 = no bus timing
+    float tolerance_us;
+  } cases[] = {
+    { 0, 0, 1 }, { 50, 0, 3 }, { 150, 0, 6 }, { 0, 400000, 10 }, { 150, 400000, 10 },
+  };
+
+  for (uint8_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    Adafruit_INA219_Sim sim;
+    Adafruit_INA219 ina219;
+    ina219_jitter_t jitter;
+    uint32_t j = cases[i].jitter_us;
+
+    Wire.setSimulator(&sim);
+    sim.setVirtualTime(true);
+    sim.setBusTiming(cases[i].clock_Hz != 0);
+    sim.addDevice(INA219_ADDRESS);
+    sim.setInput(INA219_ADDRESS, 10000, 5000);
+    sim.setConversionJitter_us(j);
+    ina219.begin();
+    if (cases[i].clock_Hz)
+      ina219.setI2CClock(cases[i].clock_Hz);
+    pollConversions(&ina219, 1000, &jitter);
+
+    // uniform over the 2j + 1 integers in [-j, j]
+    float variance = j * (j + 1) / 3.0;
+    if (cases[i].clock_Hz) {
+      float poll_us = 49 * 1e6 / cases[i].clock_Hz;
+      variance += poll_us * poll_us / 6;
+    }
+    float expected = sqrt(variance);
+    // the mean is that of the simulated jitter draws
+    float meanTolerance = 1 + 3 * sqrt(j * (j + 1) / 3.0) / sqrt(1000);
+    uint32_t nominal = ina219.getConversionTime_us();
+    printf("    +-%u us, %u Hz: %u intervals, mean %.1f us (nominal %u), stddev %.1f us (expected %.1f)\n",
+           j, cases[i].clock_Hz, jitter.count, jitter.mean_us, nominal, jitter.stddev_us, expected);
+    CHECK(jitter.count >= 1000, "only %u intervals", jitter.count);
+    CHECK(fabs(jitter.mean_us - nominal) < meanTolerance, "mean %.1f us, nominal %u us", jitter.mean_us, nominal);
+    CHECK(fabs(jitter.stddev_us - expected) < cases[i].tolerance_us, "stddev %.1f us, expected %.1f us",
+          jitter.stddev_us, expected);
+    sim.setVirtualTime(false);
+  }
+  Wire.setSimulator(NULL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Alarms: a failed read returns 0, which must neither raise
+            an alarm (0V is under-voltage) nor clear one (0mA, 0mW)
+*/
+/**************************************************************************/
+static void testAlarms(void)
+{
+  Adafruit_INA219_Sim sim;
+  Adafruit_INA219 ina219;
+  ina219_sample_t sample;
+
+  Wire.setSimulator(&sim);
+  sim.setVirtualTime(true);
+  sim.addDevice(INA219_ADDRESS);
+  sim.setInput(INA219_ADDRESS, 10000, 5000);           // 100mA at 5V
+  ina219.begin();
+  ina219.setUnderVoltageAlarm(4.0, 0.2);
+  ina219.setOverCurrentAlarm(1000, 100);
+  ina219.setOverPowerAlarm(5000, 500);
+  delay(2);
+
+  ina219.getSample(&sample);
+  CHECK(ina219.getAlarms() == 0, "alarms 0x%x on a normal sample", ina219.getAlarms());
+
+  sim.injectFault(INA219_SIM_FAULT_NACK);
+  ina219.getBusVoltage_raw();
+  CHECK(ina219.getLastError() == INA219_ERR_NACK, "bus voltage read didn't fail");
+  CHECK(ina219.getAlarms() == 0, "failed bus voltage read raised 0x%x", ina219.getAlarms());
+
+  sim.setInput(INA219_ADDRESS, 150000, 5000);          // 1.5A, 7.5W
+  delay(2);
+  ina219.getSample(&sample);
+  uint8_t raised = INA219_ALARM_OVERCURRENT | INA219_ALARM_OVERPOWER;
+  CHECK(ina219.getAlarms() == raised, "alarms 0x%x, expected 0x%x", ina219.getAlarms(), raised);
+
+  // each failed access in turn: shunt read, calibration write, CURRENT
+  // read, POWER read, then the bus read of a software power sample
+  sim.injectFault(INA219_SIM_FAULT_NACK);
+  ina219.getShuntVoltage_raw();
+  CHECK(ina219.getAlarms() == raised, "failed shunt read left 0x%x", ina219.getAlarms());
+  sim.injectFault(INA219_SIM_FAULT_NACK);
+  ina219.getCurrent_raw();
+  CHECK(ina219.getAlarms() == raised, "failed calibration write left 0x%x", ina219.getAlarms());
+  sim.injectFault(INA219_SIM_FAULT_NACK, 1, 2);
+  ina219.getCurrent_raw();
+  CHECK(ina219.getAlarms() == raised, "failed CURRENT read left 0x%x", ina219.getAlarms());
+  sim.injectFault(INA219_SIM_FAULT_NACK);
+  ina219.getPower_raw();
+  CHECK(ina219.getAlarms() == raised, "failed POWER read left 0x%x", ina219.getAlarms());
+  ina219.setSoftwarePower(true);
+  sim.injectFault(INA219_SIM_FAULT_NACK, 1, 2);
+  ina219.getPower_raw();
+  CHECK(ina219.getAlarms() == raised, "failed bus read of software power left 0x%x",
+        ina219.getAlarms());
+  sim.injectFault(INA219_SIM_FAULT_NACK, 1, 2);
+  ina219.getSample(&sample);
+  CHECK(ina219.getAlarms() == raised, "failed bus read of a sample left 0x%x", ina219.getAlarms());
+  CHECK(ina219.getErrorCount() == 7, "%u failed reads, expected 7", ina219.getErrorCount());
+
+  // and real readings still clear them
+  sim.setInput(INA219_ADDRESS, 10000, 5000);
+  delay(2);
+  ina219.getSample(&sample);
+  CHECK(ina219.getAlarms() == 0, "alarms 0x%x after the load dropped", ina219.getAlarms());
+
+  sim.setVirtualTime(false);
+  Wire.setSimulator(NULL);
+}
+
+static uint16_t recoveries;
+
+static void countRecovery(void)
+{
+  recoveries++;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Retry policy: NACKs and short reads are retried through the
+            recovery hook, a stuck bus ends every public call within
+            its deadline however many accesses it makes, and failed
+            reads don't move the auto-range or adaptive averaging
+*/
+/**************************************************************************/
+static void testRetries(void)
+{
+  Adafruit_INA219_Sim sim;
+  Adafruit_INA219 ina219;
+  ina219_sample_t sample;
+  int16_t shunt, bus;
+
+  Wire.setSimulator(&sim);
+  sim.setVirtualTime(true);
+  sim.addDevice(INA219_ADDRESS);
+  sim.setInput(INA219_ADDRESS, 10000, 5000);
+  ina219.begin();
+  ina219.setBusRecovery(countRecovery);
+  ina219.setRetryPolicy(3, 5000);
+  delay(2);
+
+  recoveries = 0;
+  sim.injectFault(INA219_SIM_FAULT_NACK, 2);
+  CHECK(fabs(ina219.getBusVoltage_V() - 5.0) < 0.01, "NACKs weren't retried");
+  sim.injectFault(INA219_SIM_FAULT_SHORT, 1);
+  CHECK(fabs(ina219.getShuntVoltage_mV() - 10.0) < 0.01, "short read wasn't retried");
+  CHECK(ina219.getRetryCount() == 3, "%u retries, expected 3", ina219.getRetryCount());
+  CHECK(recoveries == 3, "%u bus recoveries, expected 3", recoveries);
+
+  // with the bus stuck each transfer waits for what is left of the
+  // deadline, the first one uses it all up
+  static const char *calls[] = {
+    "getSample", "getCurrent_mA", "getPower_mW", "setCalibration_32V_1A", "readConversion",
+  };
+  ina219.setAutoRange(true);
+  for (uint8_t i = 0; i < sizeof(calls) / sizeof(calls[0]); i++) {
+    sim.injectFault(INA219_SIM_FAULT_STUCK, 1000);
+    uint32_t start = micros();
+    switch (i) {
+      case 0: ina219.getSample(&sample); break;
+      case 1: ina219.getCurrent_mA(); break;
+      case 2: ina219.getPower_mW(); break;
+      case 3: ina219.setCalibration_32V_1A(); break;
+      case 4: ina219.readConversion(&shunt, &bus); break;
+    }
+    uint32_t elapsed = micros() - start;
+    CHECK(elapsed < 5500, "%s took %u us with a 5000 us deadline", calls[i], elapsed);
+    CHECK(ina219.getLastError() == INA219_ERR_TIMEOUT, "%s: last error %u", calls[i],
+          ina219.getLastError());
+  }
+  sim.injectFault(INA219_SIM_FAULT_NONE, 0);
+  ina219.setCalibration_32V_2A();
+
+  // 100mV settles in the 160mV range, a failed read's 0 would step down
+  ina219.setRetryPolicy(0, 0);
+  sim.setInput(INA219_ADDRESS, 100000, 5000);
+  for (uint8_t i = 0; i < 4; i++) {
+    delay(2);
+    ina219.getShuntVoltage_raw();
+  }
+  uint16_t switches = ina219.getRangeSwitches();
+  sim.injectFault(INA219_SIM_FAULT_NACK);
+  ina219.getShuntVoltage_raw();
+  CHECK(ina219.getRangeSwitches() == switches, "failed read switched the range");
+  ina219.setAutoRange(false);
+
+  // a steady input climbs, a 0 in the window would look like noise
+  ina219.setAdaptiveAveraging(10);
+  uint32_t start = millis();
+  while (ina219.getAveragingLevel() < 2 && millis() - start < 10000) {
+    delay(ina219.getConversionTime_us() / 1000 + 1);
+    ina219.getShuntVoltage_raw();
+  }
+  uint8_t level = ina219.getAveragingLevel();
+  sim.injectFault(INA219_SIM_FAULT_NACK);
+  for (uint8_t i = 0; i < INA219_ADAPT_WINDOW; i++) {
+    delay(ina219.getConversionTime_us() / 1000 + 1);
+    ina219.getShuntVoltage_raw();
+  }
+  CHECK(level >= 2 && ina219.getAveragingLevel() >= level, "averaging level %u after a failed read, was %u",
+        ina219.getAveragingLevel(), level);
+
+  sim.setVirtualTime(false);
+  Wire.setSimulator(NULL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Group reads: a range step of one sensor mustn't write its
+            config (starting a new conversion) or wait for one while
+            the group is read, and software power sensors only have
+            their voltages read.  Reading sample by sample, the range
+            step's config write cleared CNVR before the bus read.
+*/
+/**************************************************************************/
+static void testGroup(void)
+{
+  static const uint8_t addrs[3] = { 0x40, 0x41, 0x44 };
+  Adafruit_INA219_Sim sim;
+  Adafruit_INA219 sensors[3] = { Adafruit_INA219(0x40), Adafruit_INA219(0x41), Adafruit_INA219(0x44) };
+  Adafruit_INA219_Group group;
+  ina219_sample_t samples[3];
+
+  Wire.setSimulator(&sim);
+  sim.setVirtualTime(true);
+  for (uint8_t i = 0; i < 3; i++) {
+    sim.addDevice(addrs[i]);
+    sim.setInput(addrs[i], 10000, 5000);
+    sensors[i].begin();
+    group.add(&sensors[i]);
+  }
+  sensors[2].setSoftwarePower(true);
+  CHECK(group.acquire(samples) == 3, "not every sensor had a new conversion");
+
+  // 100mV settles in the 160mV range: one step down from 320mV
+  sensors[0].setAutoRange(true);
+  sim.setInput(addrs[0], 100000, 5000);
+  group.trigger();
+  uint32_t transactions = sim.getTransactions(addrs[2]);
+  uint8_t fresh = group.read(samples);
+  CHECK(fresh == 3, "%u of 3 sensors had a new conversion", fresh);
+  CHECK(sensors[0].getRangeSwitches() == 1, "%u range switches", sensors[0].getRangeSwitches());
+  CHECK(group.getReadTime_us() < group.getConversionTime_us(), "read took %u us",
+        group.getReadTime_us());
+  CHECK(sim.getTransactions(addrs[2]) - transactions == 4, "%u transfers for a software power sample",
+        sim.getTransactions(addrs[2]) - transactions);
+  CHECK(samples[0].shunt == 10000, "shunt %d, expected 10000", samples[0].shunt);
+  CHECK(samples[2].current == samples[2].shunt && samples[2].power == 1000L * 5000,
+        "software power sample %d, %ld", samples[2].current, (long)samples[2].power);
+
+  // and the new range is used from the next trigger on
+  CHECK(group.acquire(samples) == 3 && samples[0].shunt == 10000, "shunt %d after the range step",
+        samples[0].shunt);
+
+  sim.setVirtualTime(false);
+  Wire.setSimulator(NULL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  ADC setting changes go through the shadowed config: during a
+            duty cycle the chip is powered down, and reading its config
+            back put power-down in the shadow, so leaving the duty cycle
+            left the chip off
+*/
+/**************************************************************************/
+static void testConfig(void)
+{
+  Adafruit_INA219_Sim sim;
+  Adafruit_INA219 ina219;
+
+  Wire.setSimulator(&sim);
+  sim.setVirtualTime(true);
+  sim.addDevice(INA219_ADDRESS);
+  ina219.begin();
+  ina219.setDutyCycle(100);
+  ina219.setAmpInstant();
+  ina219.setVoltInstant();
+  ina219.setDutyCycle(0);
+
+  uint32_t conversions = sim.getConversions(INA219_ADDRESS);
+  delay(20);
+  uint32_t done = sim.getConversions(INA219_ADDRESS) - conversions;
+  CHECK(done >= 15, "%u conversions in 20 ms after the duty cycle", done);
+
+  sim.setVirtualTime(false);
+  Wire.setSimulator(NULL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Decimation: one output per 2^log2Ratio readings less the
+            settling ones, a DC gain of exactly 2^INA219_DECIM_FRAC_BITS
+            on bus readings for both filters, and the ratio clamp
+*/
+/**************************************************************************/
+static void testDecimator(void)
+{
+  Adafruit_INA219_Sim sim;
+  Adafruit_INA219 ina219;
+  Adafruit_INA219_Decimator boxcar(4, INA219_DECIM_BOXCAR);
+  Adafruit_INA219_Decimator cic2(4, INA219_DECIM_CIC2);
+  uint32_t boxcarOut = 0, cic2Out = 0;
+
+  Wire.setSimulator(&sim);
+  sim.setVirtualTime(true);
+  sim.addDevice(INA219_ADDRESS);
+  ina219.begin();
+  ina219.setAmpFast();
+  sim.setInput(INA219_ADDRESS, 1230, 5000);
+  delay(2);
+
+  for (int i = 0; i < 1000; i++) {
+    int16_t raw = ina219.getShuntVoltage_raw();
+    boxcarOut += boxcar.push(raw);
+    cic2Out += cic2.push(raw);
+  }
+  CHECK(boxcar.getInputCount() == 1000 && boxcar.getOutputCount() == 62 && boxcarOut == 62,
+        "boxcar: %u inputs, %u outputs, %u returned", boxcar.getInputCount(),
+        boxcar.getOutputCount(), boxcarOut);
+  CHECK(cic2.getOutputCount() == 62 && cic2Out == 61, "cic2: %u outputs, %u returned",
+        cic2.getOutputCount(), cic2Out);
+  CHECK(boxcar.getFast() == 123, "fast stream %d, expected 123", boxcar.getFast());
+  CHECK(boxcar.getOutput() == 123 << INA219_DECIM_FRAC_BITS &&
+        cic2.getOutput() == 123 << INA219_DECIM_FRAC_BITS,
+        "DC gain: boxcar %ld, cic2 %ld, expected %d", (long)boxcar.getOutput(),
+        (long)cic2.getOutput(), 123 << INA219_DECIM_FRAC_BITS);
+
+  sim.setVirtualTime(false);
+  Wire.setSimulator(NULL);
+
+  // negative and full scale readings at the largest ratio
+  Adafruit_INA219_Decimator wide(16, INA219_DECIM_BOXCAR);
+  CHECK(wide.getRatio() == 32768, "ratio %u for log2 16, expected the 2^15 clamp", wide.getRatio());
+  for (uint32_t i = 0; i < 32768; i++)
+    wide.push(-32000);
+  CHECK(wide.getOutputCount() == 1 && wide.getOutput() == -32000L << INA219_DECIM_FRAC_BITS,
+        "full scale output %ld", (long)wide.getOutput());
+  Adafruit_INA219_Decimator deep(16, INA219_DECIM_CIC2);
+  CHECK(deep.getRatio() == 256, "cic2 ratio %u for log2 16, expected 256", deep.getRatio());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Polls 'capture' every 100 us until it is done or 'time_ms'
+            have passed
+*/
+/**************************************************************************/
+static void pollCapture(Adafruit_INA219_Capture *capture, uint32_t time_ms)
+{
+  for (uint32_t i = 0; i < time_ms * 10 && !capture->poll(); i++)
+    delayMicroseconds(100);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Polls 'capture' until it holds one more sample or is done
+*/
+/**************************************************************************/
+static void pollCaptureSample(Adafruit_INA219_Capture *capture)
+{
+  uint16_t available = capture->available();
+  for (uint32_t i = 0; i < 10000 && capture->available() == available && !capture->poll(); i++)
+    delayMicroseconds(100);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Captures: the pre-trigger window holds the samples before
+            the trigger and the post one the trigger sample on, early
+            triggers shorten the pre window, and a slew-rate limit
+            under one shunt bit per ms still tells a slow ramp from a
+            step
+*/
+/**************************************************************************/
+static void testCapture(void)
+{
+  Adafruit_INA219_Sim sim;
+  Adafruit_INA219 ina219;
+  ina219_capture_t buffer[12];
+
+  Wire.setSimulator(&sim);
+  sim.setVirtualTime(true);
+  sim.addDevice(INA219_ADDRESS);
+  ina219.begin();
+  sim.setInput(INA219_ADDRESS, 10000, 5000);
+
+  Adafruit_INA219_Capture capture(&ina219, buffer, 8, 4);
+  capture.setOverCurrent(500);
+  pollCapture(&capture, 25);
+  CHECK(!capture.isTriggered() && capture.available() == 12, "before the step: %s, %u samples",
+        capture.isTriggered() ? "triggered" : "armed", capture.available());
+
+  sim.setInput(INA219_ADDRESS, 100000, 5000);
+  pollCapture(&capture, 25);
+  CHECK(capture.isDone() && capture.getTriggerCause() == INA219_TRIG_OVERCURRENT,
+        "after the step: done %d, cause 0x%x", capture.isDone(), capture.getTriggerCause());
+  CHECK(capture.available() == 12 && capture.getTriggerIndex() == 8, "%u samples, trigger at %u",
+        capture.available(), capture.getTriggerIndex());
+  for (uint16_t i = 0; i < capture.available(); i++) {
+    const ina219_capture_t *sample = capture.getSample(i);
+    int16_t expected = (i < 8) ? 1000 : 10000;
+    CHECK(sample->shunt == expected && sample->bus == 5000,
+          "sample %u: shunt %d, bus %d", i, sample->shunt, sample->bus);
+    CHECK(i == 0 || sample->time_us > capture.getSample(i - 1)->time_us,
+          "sample %u not after the previous one", i);
+  }
+  uint32_t last_us = capture.getSample(11)->time_us;
+  delay(10);
+  CHECK(capture.poll() && capture.getSample(11)->time_us == last_us, "done capture overwritten");
+
+  // the input is already over the limit: no pre-trigger samples
+  capture.arm();
+  pollCapture(&capture, 25);
+  CHECK(capture.isDone() && capture.available() == 4 && capture.getTriggerIndex() == 0,
+        "early trigger: %u samples, trigger at %u", capture.available(), capture.getTriggerIndex());
+
+  // 0.05 mA/ms is half a shunt bit per ms: 500 bits/s over 136 ms
+  // conversions, where a bit per conversion is 7 bits/s
+  ina219.setAmpAverage();
+  ina219.setVoltAverage();
+  sim.setInput(INA219_ADDRESS, 10000, 5000);
+  capture.clearTriggers();
+  CHECK(!capture.setSlewRate(0), "a zero slew rate was accepted");
+  CHECK(capture.setSlewRate(0.05), "slew rate refused");
+  capture.arm();
+  pollCaptureSample(&capture);
+  pollCaptureSample(&capture);
+  for (int i = 1; i <= 5; i++) {
+    sim.setInput(INA219_ADDRESS, 10000 + 10 * i, 5000);
+    pollCaptureSample(&capture);
+  }
+  CHECK(!capture.isTriggered(), "ramp of a bit per conversion triggered");
+  sim.setInput(INA219_ADDRESS, 11000, 5000);
+  pollCapture(&capture, 1000);
+  CHECK(capture.isDone() && capture.getTriggerCause() == INA219_TRIG_SLEWRATE &&
+        capture.getSample(capture.getTriggerIndex())->shunt == 1100,
+        "step of 95 bits: done %d, cause 0x%x", capture.isDone(), capture.getTriggerCause());
+
+  sim.setVirtualTime(false);
+  Wire.setSimulator(NULL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Goertzel bank: a tone on a bin reads back its amplitude,
+            a bin elsewhere stays quiet, bins too near DC or Nyquist
+            are refused, and a full scale tone at the edge of the
+            allowed bins keeps the resonators in range
+*/
+/**************************************************************************/
+static void testGoertzel(void)
+{
+  // 10 kHz, 256 readings: 39.0625 Hz bins, the tone on bin 26
+  Adafruit_INA219_Goertzel bank(10000, 256);
+  CHECK(bank.addBin(50) < 0 && bank.addBin(4990) < 0, "bins at the edges accepted");
+  CHECK(bank.addBin(1015.625) == 0 && bank.addBin(2500) == 1 && bank.getBinCount() == 2,
+        "%u bins added", bank.getBinCount());
+
+  uint32_t blocks = 0;
+  for (int n = 0; n < 3 * 256; n++)
+    blocks += bank.push((int16_t)lround(500 + 100 * sin(2 * M_PI * 1015.625 * n / 10000)));
+  CHECK(blocks == 3 && bank.getBlockCount() == 3, "%u blocks", bank.getBlockCount());
+  CHECK(fabs(bank.getAmplitude_raw(0) - 100) < 1, "tone amplitude %g, expected 100",
+        bank.getAmplitude_raw(0));
+  CHECK(bank.getAmplitude_raw(1) < 1, "%g on the quiet bin", bank.getAmplitude_raw(1));
+  CHECK(fabs(bank.getAmplitude_mV(0) - 1) < 0.01, "tone amplitude %g mV, expected 1",
+        bank.getAmplitude_mV(0));
+
+  // 512 Hz, 512 readings: 1 Hz bins, 4 Hz is the lowest allowed
+  Adafruit_INA219_Goertzel edge(512, 512);
+  CHECK(edge.addBin(4) == 0, "bin at the edge refused");
+  for (int n = 0; n < 512; n++)
+    edge.push((int16_t)lround(30000 * sin(2 * M_PI * 4 * n / 512)));
+  // the Q14 coefficient is coarsest near DC, 0.2% here
+  CHECK(fabs(edge.getAmplitude_raw(0) - 30000) < 150, "full scale amplitude %g, expected 30000",
+        edge.getAmplitude_raw(0));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Tiny driver: integer readings in uV, mV, uA and uW, with the
+            POWER register read unsigned above 32767
+*/
+/**************************************************************************/
+static void testTiny(void)
+{
+  static const struct {
+    int32_t shunt_uV;
+    int32_t bus_mV;
+    int32_t current_uA;
+    int32_t power_uW;
+  } cases[] = {
+    { 10000, 5000, 100000, 500000 },
+    { -12340, 5000, -123400, 616000 },      // POWER 308.5 truncated
+    { 320000, 26000, 3200000, 83200000 },   // POWER 41600
+  };
+  Adafruit_INA219_Sim sim;
+  Adafruit_INA219_Tiny tiny;
+
+  Wire.setSimulator(&sim);
+  sim.setVirtualTime(true);
+  sim.addDevice(INA219_ADDRESS);
+  tiny.begin();
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    sim.setInput(INA219_ADDRESS, cases[i].shunt_uV, cases[i].bus_mV);
+    delay(2);
+    int32_t shunt = tiny.getShuntVoltage_uV();
+    uint16_t bus = tiny.getBusVoltage_mV();
+    int32_t current = tiny.getCurrent_uA();
+    int32_t power = tiny.getPower_uW();
+    CHECK(shunt == cases[i].shunt_uV && bus == cases[i].bus_mV &&
+          current == cases[i].current_uA && power == cases[i].power_uW,
+          "%ld uV, %u mV, %ld uA, %ld uW; expected %ld, %ld, %ld, %ld", (long)shunt, bus,
+          (long)current, (long)power, (long)cases[i].shunt_uV, (long)cases[i].bus_mV,
+          (long)cases[i].current_uA, (long)cases[i].power_uW);
+  }
+
+  sim.setVirtualTime(false);
+  Wire.setSimulator(NULL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Appends records 'first' to 'last' to 'log', time_ns = seq
+*/
+/**************************************************************************/
+static void appendRecords(Adafruit_INA219_Log *log, uint64_t first, uint64_t last)
+{
+  ina219_record_t record;
+
+  memset(&record, 0, sizeof(record));
+  for (uint64_t seq = first; seq <= last; seq++) {
+    record.time_ns = seq;
+    log->append(&record);
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Overwrites the seq of the slot holding record 'seq' in the
+            log file 'fd' of 'slots' slots, as a lost write would
+*/
+/**************************************************************************/
+static void setSlotSeq(int fd, uint32_t slots, uint64_t seq, uint64_t value)
+{
+  off_t offset = INA219_LOG_HEADER_SIZE + ((seq - 1) & (slots - 1)) * sizeof(ina219_log_slot_t);
+  CHECK(pwrite(fd, &value, sizeof(value), offset) == sizeof(value), "pwrite: %s", strerror(errno));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Crash recovery of the sample log: unsynced records past the
+            commit index are kept while consecutive, a lost slot ends
+            the run, a lost commit slot falls back to a scan, and a
+            file that isn't a log (or a truncated one) is refused with
+            EINVAL rather than reinitialised
+*/
+/**************************************************************************/
+static void testLog(void)
+{
+  char path[] = "/tmp/ina219test.XXXXXX";
+  int fd = mkstemp(path);
+  Adafruit_INA219_Log log;
+  ina219_record_t record;
+  struct stat st;
+
+  CHECK(fd >= 0, "mkstemp: %s", strerror(errno));
+  if (fd < 0)
+    return;
+
+  // an empty file is a new log
+  CHECK(log.open(path, 16), "open new: %s", strerror(errno));
+  CHECK(log.head() == 0 && log.getRecovered() == 0, "new log holds %llu",
+        (unsigned long long)log.getRecovered());
+  appendRecords(&log, 1, 10);
+  log.sync();
+  appendRecords(&log, 11, 13);
+  log.close();
+
+  CHECK(log.open(path, 16), "reopen: %s", strerror(errno));
+  CHECK(log.head() == 13 && log.getRecovered() == 13, "head %llu, %llu recovered",
+        (unsigned long long)log.head(), (unsigned long long)log.getRecovered());
+  CHECK(log.read(13, &record) && record.time_ns == 13, "record 13 not read back");
+  log.close();
+
+  // record 12 lost: 13 is past the gap and dropped
+  setSlotSeq(fd, 16, 12, 0);
+  CHECK(log.open(path, 16), "reopen: %s", strerror(errno));
+  CHECK(log.head() == 11 && log.getRecovered() == 11, "head %llu, %llu recovered",
+        (unsigned long long)log.head(), (unsigned long long)log.getRecovered());
+  CHECK(!log.read(13, &record), "record 13 read past the gap");
+  log.close();
+
+  // the commit index (10) lost: the newest record found wins
+  setSlotSeq(fd, 16, 10, 0);
+  CHECK(log.open(path, 16), "reopen: %s", strerror(errno));
+  CHECK(log.head() == 11 && log.getRecovered() == 1, "head %llu, %llu recovered",
+        (unsigned long long)log.head(), (unsigned long long)log.getRecovered());
+  log.close();
+
+  // wrapped: only the last 16 are held
+  CHECK(log.open(path, 16), "reopen: %s", strerror(errno));
+  appendRecords(&log, 12, 40);
+  log.sync();
+  log.close();
+  CHECK(log.open(path, 16), "reopen: %s", strerror(errno));
+  CHECK(log.head() == 40 && log.oldest() == 25 && log.getRecovered() == 16,
+        "head %llu, oldest %llu, %llu recovered", (unsigned long long)log.head(),
+        (unsigned long long)log.oldest(), (unsigned long long)log.getRecovered());
+  log.close();
+
+  // a truncated log is refused and kept
+  off_t size = INA219_LOG_HEADER_SIZE + 5 * sizeof(ina219_log_slot_t);
+  CHECK(ftruncate(fd, size) == 0, "ftruncate: %s", strerror(errno));
+  errno = 0;
+  CHECK(!log.open(path, 16) && errno == EINVAL, "truncated log opened (errno %d)", errno);
+  CHECK(fstat(fd, &st) == 0 && st.st_size == size, "truncated log resized to %lld",
+        (long long)st.st_size);
+
+  // so is anything else
+  static const char text[] = "not a log\n";
+  CHECK(ftruncate(fd, 0) == 0 && pwrite(fd, text, sizeof(text) - 1, 0) == sizeof(text) - 1,
+        "rewrite: %s", strerror(errno));
+  errno = 0;
+  CHECK(!log.open(path, 16) && errno == EINVAL, "text file opened (errno %d)", errno);
+  CHECK(fstat(fd, &st) == 0 && st.st_size == sizeof(text) - 1, "text file resized to %lld",
+        (long long)st.st_size);
+
+  ::close(fd);
+  unlink(path);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Gets 'time_s' seconds and 'frac_ns' in ns, for Rollup::add()
+*/
+/**************************************************************************/
+static uint64_t rollupTime_ns(int64_t time_s, uint32_t frac_ns)
+{
+  return (uint64_t)time_s * 1000000000 + frac_ns;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Rollups: samples either side of a second, minute and hour
+            boundary land in their own buckets and close the previous
+            ones, and each level keeps only its newest buckets once its
+            ring rolls over, dropping late samples for recycled buckets
+*/
+/**************************************************************************/
+static void testRollup(void)
+{
+  static const uint32_t kept[INA219_ROLLUP_LEVELS] = { 4, 3, 2 };
+  static const uint8_t all = (1 << INA219_ROLLUP_SECOND) | (1 << INA219_ROLLUP_MINUTE) |
+                             (1 << INA219_ROLLUP_HOUR);
+  const int64_t h0 = 1700000000 - 1700000000 % 3600;
+  Adafruit_INA219_Rollup rollup;
+  ina219_rollup_t b[8];
+  uint8_t closed;
+  uint32_t n;
+
+  CHECK(rollup.begin(1, kept), "begin failed");
+
+  // the last ns of an hour, then the first of the next
+  closed = rollup.add(0, rollupTime_ns(h0 + 3599, 500000000), 100, 5, 1000);
+  CHECK(closed == 0, "first sample closed 0x%x", closed);
+  closed = rollup.add(0, rollupTime_ns(h0 + 3599, 999999999), 100, 5, 1000);
+  CHECK(closed == 0, "sample in the same second closed 0x%x", closed);
+  closed = rollup.add(0, rollupTime_ns(h0 + 3600, 0), 200, 5, 1000);
+  CHECK(closed == all, "hour boundary closed 0x%x", closed);
+  closed = rollup.add(0, rollupTime_ns(h0 + 3600, 500000000), 200, 5, 1000);
+  CHECK(closed == 0, "sample in the same second closed 0x%x", closed);
+  n = rollup.query(0, INA219_ROLLUP_SECOND, h0 + 3599, h0 + 3601, b, 8);
+  CHECK(n == 2 && b[0].start_s == h0 + 3599 && b[0].count == 2 &&
+        b[1].start_s == h0 + 3600 && b[1].count == 2,
+        "%u second buckets around the hour", n);
+  // 1000 mW for 0.5 s, the 1 ns step into the next second goes there
+  CHECK(n == 2 && fabs(b[0].energy_J - 0.5) < 1e-6 && fabs(b[1].energy_J - 0.5) < 1e-6,
+        "energy %g J, %g J", b[0].energy_J, b[1].energy_J);
+  closed = rollup.add(0, rollupTime_ns(h0 + 3660, 0), 300, 5, 1000);
+  CHECK(closed == ((1 << INA219_ROLLUP_SECOND) | (1 << INA219_ROLLUP_MINUTE)),
+        "minute boundary closed 0x%x", closed);
+  closed = rollup.add(0, rollupTime_ns(h0 + 3661, 0), 300, 5, 1000);
+  CHECK(closed == (1 << INA219_ROLLUP_SECOND), "second boundary closed 0x%x", closed);
+
+  n = rollup.query(0, INA219_ROLLUP_MINUTE, h0 + 3540, h0 + 3720, b, 8);
+  CHECK(n == 3 && b[0].count == 2 && b[1].count == 2 && b[2].count == 2 &&
+        b[1].current_mA.min == 200 && b[2].current_mA.min == 300,
+        "%u minute buckets around the hour", n);
+  n = rollup.query(0, INA219_ROLLUP_HOUR, h0, h0 + 7200, b, 8);
+  CHECK(n == 2 && b[0].start_s == h0 && b[0].count == 2 && b[1].start_s == h0 + 3600 &&
+        b[1].count == 4 && b[1].current_mA.max == 300,
+        "%u hour buckets around the hour", n);
+  // [from, to) takes the buckets starting in it
+  n = rollup.query(0, INA219_ROLLUP_MINUTE, h0 + 3600, h0 + 3660, b, 8);
+  CHECK(n == 1 && b[0].start_s == h0 + 3600, "%u minute buckets in [3600, 3660)", n);
+
+  // a sample a second for 10 s: the last 4 seconds stay
+  rollup.begin(1, kept);
+  for (int i = 0; i < 10; i++)
+    rollup.add(0, rollupTime_ns(h0 + i, 0), i, 5, 1000);
+  n = rollup.query(0, INA219_ROLLUP_SECOND, h0, h0 + 10, b, 8);
+  CHECK(n == 4 && b[0].start_s == h0 + 6 && b[3].start_s == h0 + 9,
+        "%u second buckets after rollover, first at +%lld", n,
+        n ? (long long)(b[0].start_s - h0) : -1LL);
+  n = rollup.query(0, INA219_ROLLUP_MINUTE, h0, h0 + 60, b, 8);
+  CHECK(n == 1 && b[0].count == 10, "first minute holds %u", n ? b[0].count : 0);
+
+  // a sample a minute for 4 more minutes: the last 3 minutes stay
+  for (int i = 1; i <= 4; i++)
+    rollup.add(0, rollupTime_ns(h0 + 60 * i, 0), 0, 5, 1000);
+  n = rollup.query(0, INA219_ROLLUP_MINUTE, h0, h0 + 3600, b, 8);
+  CHECK(n == 3 && b[0].start_s == h0 + 120 && b[2].start_s == h0 + 240,
+        "%u minute buckets after rollover", n);
+
+  // a sample an hour for 2 more hours: the last 2 hours stay
+  for (int i = 1; i <= 2; i++)
+    rollup.add(0, rollupTime_ns(h0 + 3600 * i, 0), 0, 5, 1000);
+  n = rollup.query(0, INA219_ROLLUP_HOUR, h0, h0 + 3 * 3600, b, 8);
+  CHECK(n == 2 && b[0].start_s == h0 + 3600 && b[1].start_s == h0 + 7200,
+        "%u hour buckets after rollover", n);
+
+  // a late sample for recycled buckets changes nothing
+  closed = rollup.add(0, rollupTime_ns(h0 + 5, 0), 0, 5, 1000);
+  CHECK(closed == 0, "late sample closed 0x%x", closed);
+  CHECK(rollup.summarize(0, INA219_ROLLUP_HOUR, h0, h0 + 3 * 3600, &b[0]) && b[0].count == 2,
+        "hours hold %u samples after a late one", b[0].count);
+  CHECK(rollup.query(0, INA219_ROLLUP_SECOND, h0, h0 + 10, b, 8) == 0,
+        "late sample kept in the second buckets");
+}
+
+typedef struct {
+  const char *name;
+  void (*run)(void);
+} test_t;
+
+static const test_t tests[] = {
+  { "jitter", testJitter },
+  { "alarms", testAlarms },
+  { "retries", testRetries },
+  { "group", testGroup },
+  { "config", testConfig },
+  { "decimator", testDecimator },
+  { "capture", testCapture },
+  { "goertzel", testGoertzel },
+  { "tiny", testTiny },
+  { "log", testLog },
+  { "rollup", testRollup },
+};
+
+int main(int argc, char **argv)
+{
+  int ran = 0;
+
+  for (uint8_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+    bool selected = (argc < 2);
+    for (int a = 1; a < argc; a++)
+      selected |= strcmp(argv[a], tests[i].name) == 0;
+    if (!selected)
+      continue;
+
+    int before = failures;
+    printf("%s\n", tests[i].name);
+    tests[i].run();
+    printf("%s: %s\n", tests[i].name, failures == before ? "ok" : "FAILED");
+    ran++;
+  }
+  if (ran == 0) {
+    fprintf(stderr, "ina219test: no such test\n");
+    return 1;
+  }
+  return failures ? 1 : 0;
+}